@@ -0,0 +1,418 @@
+/**
+ * @file lincov.hpp
+ * @brief Linear covariance analysis along a nominal ECEF trajectory
+ */
+
+#pragma once
+#include <math.h>
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+#include "rotation.hpp"
+
+namespace ennui {
+namespace analysis {
+
+typedef Eigen::Matrix<double, 15, 1, EIGEN_STORAGE> Vector15;
+typedef Eigen::Matrix<double, 15, 15, EIGEN_STORAGE> Matrix15x15;
+
+//! Offsets of the 3-component blocks of the LinCov error state
+enum ErrorBlock {
+  POSITION_ERROR = 0,
+  VELOCITY_ERROR = 3,
+  ATTITUDE_ERROR = 6,
+  ACCEL_BIAS_ERROR = 9,
+  GYRO_BIAS_ERROR = 12
+};
+
+/**
+ * @brief Inertial sensor error model
+ *
+ * Biases are first-order Gauss-Markov processes with the given steady-state
+ * sigma and correlation time; a non-positive correlation time makes the bias
+ * a random constant.
+ */
+struct ImuErrorModel {
+  //! Accelerometer bias [m/s^2]
+  double accel_bias_sigma = 0.0;
+  double accel_bias_tau = 0.0;
+  //! Gyro bias [rad/s]
+  double gyro_bias_sigma = 0.0;
+  double gyro_bias_tau = 0.0;
+  //! Velocity random walk [m/s/sqrt(s)]
+  double accel_noise_density = 0.0;
+  //! Angle random walk [rad/sqrt(s)]
+  double gyro_noise_density = 0.0;
+};
+
+//! Initial navigation uncertainty, 1-sigma per axis
+struct InitialUncertainty {
+  double position_sigma = 0.0;
+  double velocity_sigma = 0.0;
+  double attitude_sigma = 0.0;
+};
+
+//! Settings of a LinCov run
+struct LinCovConfig {
+  //! Covariance propagation interval [s]; the nominal runs at the IMU rate
+  double dt = 1.0;
+};
+
+/**
+ * @brief Linear measurement of the error state
+ *
+ * Updates of the same source name share one entry of the error budget.
+ */
+struct AidingUpdate {
+  double time;
+  std::string source;
+  Eigen::MatrixXd H;
+  Eigen::MatrixXd R;
+
+  //! ECEF position fix with isotropic 1-sigma error [m]
+  static AidingUpdate position_fix(double time, double sigma,
+                                   const std::string &source = "position_fix") {
+    AidingUpdate u{time, source, Eigen::MatrixXd::Zero(3, 15),
+                   sigma * sigma * Eigen::MatrixXd::Identity(3, 3)};
+    u.H.block<3, 3>(0, POSITION_ERROR).setIdentity();
+    return u;
+  }
+
+  //! ECEF velocity fix with isotropic 1-sigma error [m/s]
+  static AidingUpdate velocity_fix(double time, double sigma,
+                                   const std::string &source = "velocity_fix") {
+    AidingUpdate u{time, source, Eigen::MatrixXd::Zero(3, 15),
+                   sigma * sigma * Eigen::MatrixXd::Identity(3, 3)};
+    u.H.block<3, 3>(0, VELOCITY_ERROR).setIdentity();
+    return u;
+  }
+};
+
+//! Covariance and error budget at one time
+struct LinCovEpoch {
+  double time;
+  //! Nominal state
+  StatePvaSO3 nominal;
+  //! Diagonal of the total covariance
+  Vector15 variance;
+  //! Diagonal of each source's contribution, in the order of sources()
+  std::vector<Vector15> budget;
+};
+
+//! Root-sum-square 1-sigma of one 3-component block of a variance diagonal
+inline double block_sigma(const Vector15 &variance, ErrorBlock block) {
+  return sqrt(variance.segment<3>(block).sum());
+}
+
+namespace detail {
+
+//! 15x15 matrix with a mask of the 3x3 blocks that may be non-zero
+struct BlockSparse {
+  Matrix15x15 m;
+  unsigned mask;
+};
+
+inline unsigned block_bit(int i, int j) { return 1u << (5 * i + j); }
+
+//! Product skipping zero blocks
+inline BlockSparse block_product(const BlockSparse &a, const BlockSparse &b) {
+  BlockSparse c;
+  c.m.setZero();
+  c.mask = 0;
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      for (int k = 0; k < 5; ++k) {
+        if ((a.mask & block_bit(i, k)) && (b.mask & block_bit(k, j))) {
+          c.m.block<3, 3>(3 * i, 3 * j).noalias() +=
+              a.m.block<3, 3>(3 * i, 3 * k) * b.m.block<3, 3>(3 * k, 3 * j);
+          c.mask |= block_bit(i, j);
+        }
+      }
+    }
+  }
+  return c;
+}
+
+/**
+ * @brief Matrix exponential of a block-sparse 15x15 matrix
+ *
+ * Scaling and squaring of a 12th-order Taylor series (truncation below 1e-13
+ * once the scaled infinity norm is at most 1/2). Products skip 3x3 blocks
+ * that are structurally zero; the error dynamics are mostly such blocks.
+ */
+inline Matrix15x15 expm_block_sparse(const Matrix15x15 &A, unsigned mask) {
+  double norm = A.cwiseAbs().rowwise().sum().maxCoeff();
+  int squarings = 0;
+  while (norm > 0.5) {
+    norm *= 0.5;
+    ++squarings;
+  }
+  const BlockSparse X{A * ldexp(1.0, -squarings), mask};
+  BlockSparse result{Matrix15x15::Identity() + X.m, mask};
+  for (int i = 0; i < 5; ++i) result.mask |= block_bit(i, i);
+  BlockSparse term = X;
+  for (int k = 2; k <= 12; ++k) {
+    term = block_product(term, X);
+    term.m /= k;
+    result.m += term.m;
+    result.mask |= term.mask;
+  }
+  for (int s = 0; s < squarings; ++s) result = block_product(result, result);
+  return result.m;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Linear covariance analysis of ECEF inertial navigation
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * The nominal trajectory is propagated at the IMU rate with fwd_pva_S03_rt
+ * and gravitation_ecef. The 15-state error covariance (position, velocity,
+ * attitude, accelerometer bias, gyro bias; attitude error psi with
+ * C_est = (I + [psi x]) C_true) is propagated every LinCovConfig::dt with the
+ * ECEF error dynamics
+ *
+ *   d(dr)/dt   = dv
+ *   d(dv)/dt   = (G - Omega^2) dr - 2 Omega dv - [(C f) x] psi + C b_a + w_a
+ *   d(psi)/dt  = -Omega psi + C b_g + w_g
+ *
+ * where G is the gravity gradient of gravitation_ecef (central differences),
+ * evaluated at the nominal state and mean specific force of each interval.
+ * The transition matrix is a block-sparse matrix exponential and the process
+ * noise is discretized by the trapezoidal rule.
+ *
+ * Each error source (initial errors, biases, noises, and each aiding source)
+ * keeps its own covariance. Updates use the gain of the total covariance, so
+ * the contributions always sum to the total: they form the error budget.
+ *
+ * See Chapter 14 \cite groves_principles_2013
+ */
+template <class GeodeMdl>
+class LinCov {
+ public:
+  LinCov(const StatePvaSO3 &initial, const InitialUncertainty &uncertainty,
+         const ImuErrorModel &imu, const LinCovConfig &config = LinCovConfig())
+      : imu_(imu), config_(config), state_(initial) {
+    sources_ = {"initial_position", "initial_velocity", "initial_attitude",
+                "accel_bias",       "gyro_bias",        "accel_noise",
+                "gyro_noise"};
+    covariance_.assign(sources_.size(), Matrix15x15::Zero());
+    set_block(covariance_[INITIAL_POSITION], POSITION_ERROR,
+              uncertainty.position_sigma);
+    set_block(covariance_[INITIAL_VELOCITY], VELOCITY_ERROR,
+              uncertainty.velocity_sigma);
+    set_block(covariance_[INITIAL_ATTITUDE], ATTITUDE_ERROR,
+              uncertainty.attitude_sigma);
+    set_block(covariance_[ACCEL_BIAS], ACCEL_BIAS_ERROR, imu.accel_bias_sigma);
+    set_block(covariance_[GYRO_BIAS], GYRO_BIAS_ERROR, imu.gyro_bias_sigma);
+    start_interval();
+    record();
+  }
+
+  //! Schedule an aiding update (applied when the nominal reaches its time)
+  void add_update(const AidingUpdate &update) {
+    if (std::find(sources_.begin(), sources_.end(), update.source) ==
+        sources_.end()) {
+      sources_.push_back(update.source);
+      covariance_.push_back(Matrix15x15::Zero());
+    }
+    pending_.push_back(update);
+    std::stable_sort(pending_.begin(), pending_.end(),
+                     [](const AidingUpdate &a, const AidingUpdate &b) {
+                       return a.time < b.time;
+                     });
+  }
+
+  /**
+   * @brief Propagate through IMU samples
+   *
+   * May be called repeatedly to continue the run. Updates are applied at the
+   * first sample at or after their time, ending the covariance interval
+   * there.
+   */
+  void run(const ImuSample *samples, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      const ImuSample &s = samples[i];
+      mechanization::ecef::fwd_pva_S03_rt<GeodeMdl>(
+          state_, geodetic::gravitation_ecef<GeodeMdl>(state_.position), s,
+          state_);
+      interval_dt_ += s.dt;
+      velocity_increment_ += s.specific_force * s.dt;
+      const bool update_due =
+          !pending_.empty() && pending_.front().time <= state_.time;
+      if (interval_dt_ >= config_.dt * (1 - 1e-9) || update_due) {
+        propagate_covariance();
+      }
+      while (!pending_.empty() && pending_.front().time <= state_.time) {
+        apply_update(pending_.front());
+        pending_.erase(pending_.begin());
+      }
+    }
+  }
+
+  //! Propagate the covariance over the samples since the last interval
+  void flush() {
+    if (interval_dt_ > 0) propagate_covariance();
+  }
+
+  //! Error source names, indexing LinCovEpoch::budget
+  const std::vector<std::string> &sources() const { return sources_; }
+  //! Covariance and budget after every interval and update
+  const std::vector<LinCovEpoch> &history() const { return history_; }
+  //! Nominal state
+  const StatePvaSO3 &state() const { return state_; }
+
+  //! Total covariance
+  Matrix15x15 covariance() const {
+    Matrix15x15 total = Matrix15x15::Zero();
+    for (const Matrix15x15 &P : covariance_) total += P;
+    return total;
+  }
+
+  //! Covariance contributed by one source
+  const Matrix15x15 &covariance(std::size_t source) const {
+    return covariance_[source];
+  }
+
+ private:
+  enum Source {
+    INITIAL_POSITION,
+    INITIAL_VELOCITY,
+    INITIAL_ATTITUDE,
+    ACCEL_BIAS,
+    GYRO_BIAS,
+    ACCEL_NOISE,
+    GYRO_NOISE
+  };
+
+  static void set_block(Matrix15x15 &P, int block, double sigma) {
+    P.block<3, 3>(block, block) = sigma * sigma * Matrix3x3::Identity();
+  }
+
+  void start_interval() {
+    interval_start_ = state_;
+    interval_dt_ = 0.0;
+    velocity_increment_.setZero();
+  }
+
+  void record() {
+    LinCovEpoch epoch;
+    epoch.time = state_.time;
+    epoch.nominal = state_;
+    epoch.variance.setZero();
+    for (const Matrix15x15 &P : covariance_) {
+      epoch.budget.push_back(P.diagonal());
+      epoch.variance += P.diagonal();
+    }
+    history_.push_back(epoch);
+  }
+
+  //! Gravity gradient of gravitation_ecef by central differences
+  static Matrix3x3 gravity_gradient(const Vector3 &position) {
+    const double h = 1.0;
+    Matrix3x3 G;
+    for (int j = 0; j < 3; ++j) {
+      const Vector3 e = h * Vector3::Unit(j);
+      G.col(j) = (geodetic::gravitation_ecef<GeodeMdl>(position + e) -
+                  geodetic::gravitation_ecef<GeodeMdl>(position - e)) /
+                 (2 * h);
+    }
+    return G;
+  }
+
+  void propagate_covariance() {
+    using detail::block_bit;
+    const double dt = interval_dt_;
+    const Matrix3x3 &C = interval_start_.attitude;
+    const Vector3 f_e = C * (velocity_increment_ / dt);
+    const Matrix3x3 Omega =
+        math::R3_to_so3({0, 0, GeodeMdl::EARTH_ROTATION_RATE});
+
+    Matrix15x15 F = Matrix15x15::Zero();
+    unsigned mask = 0;
+    auto set = [&](int i, int j, const Matrix3x3 &block) {
+      F.block<3, 3>(3 * i, 3 * j) = block;
+      mask |= block_bit(i, j);
+    };
+    set(0, 1, Matrix3x3::Identity());
+    set(1, 0, gravity_gradient(interval_start_.position) - Omega * Omega);
+    set(1, 1, -2 * Omega);
+    set(1, 2, -math::R3_to_so3(f_e));
+    set(1, 3, C);
+    set(2, 2, -Omega);
+    set(2, 4, C);
+    if (imu_.accel_bias_tau > 0) {
+      set(3, 3, -Matrix3x3::Identity() / imu_.accel_bias_tau);
+    }
+    if (imu_.gyro_bias_tau > 0) {
+      set(4, 4, -Matrix3x3::Identity() / imu_.gyro_bias_tau);
+    }
+    const Matrix15x15 Phi = detail::expm_block_sparse(F * dt, mask);
+
+    // Continuous process noise of each source (isotropic, so the same in
+    // body and ECEF axes)
+    Matrix15x15 Q[GYRO_NOISE + 1];
+    for (Matrix15x15 &q : Q) q.setZero();
+    set_block(Q[ACCEL_NOISE], VELOCITY_ERROR, imu_.accel_noise_density);
+    set_block(Q[GYRO_NOISE], ATTITUDE_ERROR, imu_.gyro_noise_density);
+    if (imu_.accel_bias_tau > 0) {
+      set_block(Q[ACCEL_BIAS], ACCEL_BIAS_ERROR,
+                imu_.accel_bias_sigma * sqrt(2 / imu_.accel_bias_tau));
+    }
+    if (imu_.gyro_bias_tau > 0) {
+      set_block(Q[GYRO_BIAS], GYRO_BIAS_ERROR,
+                imu_.gyro_bias_sigma * sqrt(2 / imu_.gyro_bias_tau));
+    }
+
+    for (std::size_t i = 0; i < covariance_.size(); ++i) {
+      Matrix15x15 P = Phi * covariance_[i] * Phi.transpose();
+      if (i <= GYRO_NOISE && !Q[i].isZero()) {
+        P += 0.5 * dt * (Phi * Q[i] * Phi.transpose() + Q[i]);
+      }
+      covariance_[i] = 0.5 * (P + P.transpose());
+    }
+    start_interval();
+    record();
+  }
+
+  void apply_update(const AidingUpdate &update) {
+    const Matrix15x15 P = covariance();
+    const Eigen::MatrixXd PHt = P * update.H.transpose();
+    const Eigen::MatrixXd S = update.H * PHt + update.R;
+    const Eigen::MatrixXd K = S.ldlt().solve(PHt.transpose()).transpose();
+    const Matrix15x15 A = Matrix15x15::Identity() - K * update.H;
+    const std::size_t source =
+        std::find(sources_.begin(), sources_.end(), update.source) -
+        sources_.begin();
+    for (std::size_t i = 0; i < covariance_.size(); ++i) {
+      Matrix15x15 Pi = A * covariance_[i] * A.transpose();
+      if (i == source) Pi += K * update.R * K.transpose();
+      covariance_[i] = 0.5 * (Pi + Pi.transpose());
+    }
+    record();
+  }
+
+  ImuErrorModel imu_;
+  LinCovConfig config_;
+  StatePvaSO3 state_;
+  std::vector<std::string> sources_;
+  std::vector<Matrix15x15> covariance_;
+  std::vector<AidingUpdate> pending_;
+  std::vector<LinCovEpoch> history_;
+  // Current covariance interval
+  StatePvaSO3 interval_start_;
+  double interval_dt_;
+  Vector3 velocity_increment_;
+};
+
+}  // namespace analysis
+}  // namespace ennui
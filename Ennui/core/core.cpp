@@ -0,0 +1,71 @@
+/**
+ * @file core.cpp
+ * @brief Explicit instantiations compiled once into Ennui::core
+ *
+ * Consumers linking Ennui::core get ENNUI_CORE defined, which turns on the
+ * matching extern template declarations at the end of each header: they call
+ * these instantiations instead of compiling their own. The matrix storage
+ * order is that of the build (ENNUI_MATRIX_ROW_MAJOR), as for every other
+ * target of the same configuration.
+ */
+
+#include "attitude_scan.hpp"
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "frame_transform.hpp"
+#include "gravitation.hpp"
+#include "imu_calibration.hpp"
+#include "wgs84.hpp"
+
+namespace ennui {
+namespace geodetic {
+
+template Vector3 gravitation_ecef<Wgs84>(ConstRefVector3 &position);
+template Vector3 position_geodetic_to_ecef<Wgs84>(
+    ConstRefVector3 &position_llh);
+
+}  // namespace geodetic
+
+namespace mechanization {
+namespace ecef {
+
+using geodetic::Wgs84;
+
+template void fwd_pva_S03_rt<Wgs84>(
+    const Vector3 &position_minus, const Vector3 &velocity_minus,
+    const Matrix3x3 &attitude_minus, const Vector3 &gravitation,
+    const Vector3 &specific_force, const Vector3 &angular_rate, double dt,
+    Vector3 &position_plus, Vector3 &velocity_plus,
+    Matrix3x3 &attitude_plus) noexcept;
+template void fwd_pva_S03_rt<Wgs84>(const StatePvaSO3 &minus,
+                                    const Vector3 &gravitation,
+                                    const ImuSample &imu,
+                                    StatePvaSO3 &plus) noexcept;
+template void fwd_pva_S03<Wgs84>(
+    ConstRefVector3 &position_minus, ConstRefVector3 &velocity_minus,
+    const Eigen::Ref<const Matrix3x3> &attitude_minus,
+    ConstRefVector3 &gravitation, ConstRefVector3 &specific_force,
+    ConstRefVector3 &angular_rate, double dt, RefVector3 position_plus,
+    RefVector3 velocity_plus, Eigen::Ref<Matrix3x3> attitude_plus);
+
+template void fwd_pva_S03_rt<Wgs84>(const StatePvaSO3 &minus,
+                                    const Vector3 &gravitation,
+                                    const ImuSample &raw,
+                                    const ImuCalibration &calibration,
+                                    StatePvaSO3 &plus) noexcept;
+template void fwd_pva_S03_rt<Wgs84>(
+    StatePvaSO3 &state, const ImuSample *raw, std::size_t count,
+    const ImuCalibration &calibration) noexcept;
+
+template void scan_attitude<Wgs84>(const Matrix3x3 &attitude_initial,
+                                   const ImuSample *samples,
+                                   std::size_t count, Matrix3x3 *attitudes,
+                                   const AttitudeScanConfig &config);
+template void scan_pva<Wgs84>(const StatePvaSO3 &initial,
+                              const ImuSample *samples, std::size_t count,
+                              StatePvaSO3 *states,
+                              const AttitudeScanConfig &config);
+
+}  // namespace ecef
+}  // namespace mechanization
+}  // namespace ennui
@@ -9,6 +9,10 @@
 #include "ennui_types.hpp"
 #include "units.hpp"
 
+#ifdef ENNUI_CORE
+#include "wgs84.hpp"
+#endif
+
 namespace ennui {
 namespace geodetic {
 
@@ -50,5 +54,12 @@ Vector3 position_geodetic_to_ecef(ConstRefVector3 &position_llh) {
   return Vector3{(N + h) * cos_phi * cos_lambda, (N + h) * cos_phi * sin_lambda,
                  (N * (1 - e2) + h) * sin_phi};
 }
+
+#ifdef ENNUI_CORE
+// Precompiled in Ennui::core
+extern template Vector3 position_geodetic_to_ecef<Wgs84>(
+    ConstRefVector3 &position_llh);
+#endif
+
 }  // namespace geodetic
 }  // namespace ennui
@@ -6,6 +6,10 @@
 #pragma once
 #include "ennui_types.hpp"
 
+#ifdef ENNUI_CORE
+#include "wgs84.hpp"
+#endif
+
 namespace ennui {
 namespace geodetic {
 
@@ -50,5 +54,11 @@ Vector3 gravitation_ecef(ConstRefVector3 &position) {
 
   return gravitation;
 }
+
+#ifdef ENNUI_CORE
+// Precompiled in Ennui::core
+extern template Vector3 gravitation_ecef<Wgs84>(ConstRefVector3 &position);
+#endif
+
 }  // namespace geodetic
 }  // namespace ennui
@@ -0,0 +1,160 @@
+/**
+ * @file local_frame.hpp
+ * @brief Local tangent-plane (ENU/NED) frame about a fixed origin
+ */
+
+#pragma once
+#include <math.h>
+
+#include <cstddef>
+
+#include "ennui_types.hpp"
+#include "frame_transform.hpp"
+#include "units.hpp"
+
+namespace ennui {
+namespace geodetic {
+
+//! Axis convention of a local tangent-plane frame
+enum class LocalAxes { ENU, NED };
+
+/**
+ * @brief Local tangent-plane frame at a fixed geodetic origin
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * The origin's ECEF position and the rotation from ECEF to the local axes are
+ * computed once at construction, so each conversion is a translation and a
+ * 3x3 product. Velocities are ECEF-relative velocities resolved in the local
+ * axes; attitudes are body-to-frame rotation matrices. Batched variants take
+ * count items stored contiguously (3 doubles per vector, 9 per matrix in the
+ * storage order of Matrix3x3); input and output may be the same array.
+ *
+ * See Section 2.4.3 \cite groves_principles_2013
+ */
+template <class GeodeMdl>
+class LocalFrame {
+ public:
+  /**
+   * @param[in] origin_llh origin as (lat [deg], lon [deg], h [m])
+   * @param[in] axes ENU or NED
+   */
+  explicit LocalFrame(ConstRefVector3 &origin_llh,
+                      LocalAxes axes = LocalAxes::ENU)
+      : axes_(axes),
+        origin_llh_(origin_llh),
+        origin_ecef_(position_geodetic_to_ecef<GeodeMdl>(origin_llh)) {
+    using ennui::math::Units;
+    const double sin_phi = sin(origin_llh[0] * Units::DEGREES);
+    const double cos_phi = cos(origin_llh[0] * Units::DEGREES);
+    const double sin_lambda = sin(origin_llh[1] * Units::DEGREES);
+    const double cos_lambda = cos(origin_llh[1] * Units::DEGREES);
+
+    // Rows are the local axes resolved in ECEF
+    const Vector3 east{-sin_lambda, cos_lambda, 0.0};
+    const Vector3 north{-sin_phi * cos_lambda, -sin_phi * sin_lambda,
+                        cos_phi};
+    const Vector3 up{cos_phi * cos_lambda, cos_phi * sin_lambda, sin_phi};
+    if (axes == LocalAxes::ENU) {
+      rotation_.row(0) = east;
+      rotation_.row(1) = north;
+      rotation_.row(2) = up;
+    } else {
+      rotation_.row(0) = north;
+      rotation_.row(1) = east;
+      rotation_.row(2) = -up;
+    }
+  }
+
+  //! Axis convention
+  LocalAxes axes() const { return axes_; }
+  //! Origin as (lat [deg], lon [deg], h [m])
+  const Vector3 &origin_llh() const { return origin_llh_; }
+  //! Origin in ECEF [m]
+  const Vector3 &origin_ecef() const { return origin_ecef_; }
+  //! Rotation from ECEF to the local axes
+  const Matrix3x3 &rotation() const { return rotation_; }
+
+  //! ECEF position to local position
+  Vector3 position_from_ecef(const Vector3 &position_ecef) const {
+    return rotation_ * (position_ecef - origin_ecef_);
+  }
+  //! Local position to ECEF position
+  Vector3 position_to_ecef(const Vector3 &position_local) const {
+    return origin_ecef_ + rotation_.transpose() * position_local;
+  }
+  //! ECEF velocity to local axes
+  Vector3 velocity_from_ecef(const Vector3 &velocity_ecef) const {
+    return rotation_ * velocity_ecef;
+  }
+  //! Velocity in local axes to ECEF
+  Vector3 velocity_to_ecef(const Vector3 &velocity_local) const {
+    return rotation_.transpose() * velocity_local;
+  }
+  //! Body-to-ECEF attitude to body-to-local attitude
+  Matrix3x3 attitude_from_ecef(const Matrix3x3 &attitude_ecef) const {
+    return rotation_ * attitude_ecef;
+  }
+  //! Body-to-local attitude to body-to-ECEF attitude
+  Matrix3x3 attitude_to_ecef(const Matrix3x3 &attitude_local) const {
+    return rotation_.transpose() * attitude_local;
+  }
+
+  //! Batched position_from_ecef
+  void position_from_ecef(const double *positions_ecef,
+                          double *positions_local, std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      MapVector3(positions_local + 3 * i) =
+          position_from_ecef(Vector3(ConstMapVector3(positions_ecef + 3 * i)));
+    }
+  }
+  //! Batched position_to_ecef
+  void position_to_ecef(const double *positions_local, double *positions_ecef,
+                        std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      MapVector3(positions_ecef + 3 * i) =
+          position_to_ecef(Vector3(ConstMapVector3(positions_local + 3 * i)));
+    }
+  }
+  //! Batched velocity_from_ecef
+  void velocity_from_ecef(const double *velocities_ecef,
+                          double *velocities_local, std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      MapVector3(velocities_local + 3 * i) = velocity_from_ecef(
+          Vector3(ConstMapVector3(velocities_ecef + 3 * i)));
+    }
+  }
+  //! Batched velocity_to_ecef
+  void velocity_to_ecef(const double *velocities_local,
+                        double *velocities_ecef, std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      MapVector3(velocities_ecef + 3 * i) = velocity_to_ecef(
+          Vector3(ConstMapVector3(velocities_local + 3 * i)));
+    }
+  }
+  //! Batched attitude_from_ecef
+  void attitude_from_ecef(const double *attitudes_ecef,
+                          double *attitudes_local, std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      MapMatrix3x3(attitudes_local + 9 * i) = attitude_from_ecef(
+          Matrix3x3(ConstMapMatrix3x3(attitudes_ecef + 9 * i)));
+    }
+  }
+  //! Batched attitude_to_ecef
+  void attitude_to_ecef(const double *attitudes_local, double *attitudes_ecef,
+                        std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      MapMatrix3x3(attitudes_ecef + 9 * i) = attitude_to_ecef(
+          Matrix3x3(ConstMapMatrix3x3(attitudes_local + 9 * i)));
+    }
+  }
+
+ private:
+  LocalAxes axes_;
+  Vector3 origin_llh_;
+  Vector3 origin_ecef_;
+  Matrix3x3 rotation_;
+};
+
+}  // namespace geodetic
+}  // namespace ennui
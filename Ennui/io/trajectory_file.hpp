@@ -0,0 +1,553 @@
+/**
+ * @file trajectory_file.hpp
+ * @brief Compact, seekable on-disk format for propagated trajectories
+ */
+
+#pragma once
+#include <math.h>
+
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "ennui_types.hpp"
+
+namespace ennui {
+namespace io {
+
+/**
+ * @brief Encoding parameters of a trajectory file
+ *
+ * In QUANTIZED mode time, position and velocity are rounded to multiples of
+ * their step, so the absolute error of each component is at most half a step.
+ * Attitude is stored as a quaternion rounded to attitude_step per component,
+ * an angular error of about 2 * attitude_step rad. LOSSLESS mode stores the
+ * exact bit patterns of all 16 doubles (time, position, velocity, 3x3
+ * attitude) and ignores the steps.
+ */
+struct TrajectoryEncoding {
+  enum Mode : std::uint32_t { LOSSLESS = 0, QUANTIZED = 1 };
+
+  Mode mode = QUANTIZED;
+  //! Records per block; blocks are the unit of seeking and decoding. At most
+  //! detail::MAX_BLOCK_RECORDS, so a block's byte size fits in 32 bits.
+  std::uint32_t block_records = 4096;
+  //! Time resolution [s]
+  double time_step = 1e-9;
+  //! Position resolution [m]
+  double position_step = 1e-4;
+  //! Velocity resolution [m/s]
+  double velocity_step = 1e-6;
+  //! Quaternion component resolution
+  double attitude_step = 1e-9;
+};
+
+/**
+ * @namespace ennui::io::detail
+ * @brief codec internals shared by TrajectoryWriter and TrajectoryReader
+ *
+ * A record is mapped to integer channels: quantized values, or IEEE-754 bit
+ * patterns in LOSSLESS mode. Within a block, each channel is stored as its
+ * second difference (the first record absolute, the second as a first
+ * difference), zig-zag mapped and written as a variable-length integer. Smooth
+ * trajectories give residuals of a byte or two per channel. All arithmetic is
+ * modulo 2^64, so the integer round trip is exact.
+ */
+namespace detail {
+
+static constexpr char FILE_MAGIC[8] = {'E', 'N', 'T', 'R', 'A', 'J', '0', '1'};
+static constexpr char INDEX_MAGIC[8] = {'E', 'N', 'T', 'R', 'I', 'D', 'X', '1'};
+static constexpr int MAX_CHANNELS = 16;
+//! Longest variable-length encoding of a 64-bit integer
+static constexpr int MAX_VARINT_BYTES = 10;
+//! Largest block whose worst-case payload size fits the 32-bit size field
+static constexpr std::uint32_t MAX_BLOCK_RECORDS =
+    0xffffffffu / (MAX_CHANNELS * MAX_VARINT_BYTES);
+
+//! Number of integer channels per record
+inline int channel_count(const TrajectoryEncoding &encoding) {
+  return encoding.mode == TrajectoryEncoding::LOSSLESS ? 16 : 11;
+}
+
+inline std::uint64_t bits_of(double x) {
+  std::uint64_t u;
+  std::memcpy(&u, &x, sizeof(u));
+  return u;
+}
+
+inline double double_of(std::uint64_t u) {
+  double x;
+  std::memcpy(&x, &u, sizeof(x));
+  return x;
+}
+
+inline std::uint64_t quantize(double x, double step) {
+  const double q = x / step;
+  if (!(fabs(q) < 4.6e18)) {
+    throw std::range_error("trajectory value exceeds quantization range");
+  }
+  return static_cast<std::uint64_t>(static_cast<std::int64_t>(llround(q)));
+}
+
+inline double dequantize(std::uint64_t q, double step) {
+  return static_cast<double>(static_cast<std::int64_t>(q)) * step;
+}
+
+/**
+ * @brief Map a state to integer channels
+ *
+ * @param[in] encoding file encoding
+ * @param[in] state state to encode
+ * @param[in,out] previous_quaternion quaternion of the previous record in the
+ * block (zero for none), used to keep consecutive quaternions in the same
+ * hemisphere so that their differences stay small
+ * @param[out] channels channel_count(encoding) integers
+ */
+inline void to_channels(const TrajectoryEncoding &encoding,
+                        const StatePvaSO3 &state, Vector4 &previous_quaternion,
+                        std::uint64_t *channels) {
+  if (encoding.mode == TrajectoryEncoding::LOSSLESS) {
+    channels[0] = bits_of(state.time);
+    for (int i = 0; i < 3; ++i) {
+      channels[1 + i] = bits_of(state.position[i]);
+      channels[4 + i] = bits_of(state.velocity[i]);
+    }
+    // Column-major regardless of storage order, files are portable
+    for (int c = 0; c < 3; ++c) {
+      for (int r = 0; r < 3; ++r) {
+        channels[7 + 3 * c + r] = bits_of(state.attitude(r, c));
+      }
+    }
+    return;
+  }
+
+  channels[0] = quantize(state.time, encoding.time_step);
+  for (int i = 0; i < 3; ++i) {
+    channels[1 + i] = quantize(state.position[i], encoding.position_step);
+    channels[4 + i] = quantize(state.velocity[i], encoding.velocity_step);
+  }
+  const Eigen::Matrix3d attitude = state.attitude;
+  const Eigen::Quaterniond q(attitude);
+  Vector4 coeffs(q.w(), q.x(), q.y(), q.z());
+  const double dot = previous_quaternion.dot(coeffs);
+  if (dot < 0 || (dot == 0 && coeffs[0] < 0)) coeffs = -coeffs;
+  previous_quaternion = coeffs;
+  for (int i = 0; i < 4; ++i) {
+    channels[7 + i] = quantize(coeffs[i], encoding.attitude_step);
+  }
+}
+
+//! Map integer channels back to a state
+inline void from_channels(const TrajectoryEncoding &encoding,
+                          const std::uint64_t *channels, StatePvaSO3 &state) {
+  if (encoding.mode == TrajectoryEncoding::LOSSLESS) {
+    state.time = double_of(channels[0]);
+    for (int i = 0; i < 3; ++i) {
+      state.position[i] = double_of(channels[1 + i]);
+      state.velocity[i] = double_of(channels[4 + i]);
+    }
+    for (int c = 0; c < 3; ++c) {
+      for (int r = 0; r < 3; ++r) {
+        state.attitude(r, c) = double_of(channels[7 + 3 * c + r]);
+      }
+    }
+    return;
+  }
+
+  state.time = dequantize(channels[0], encoding.time_step);
+  for (int i = 0; i < 3; ++i) {
+    state.position[i] = dequantize(channels[1 + i], encoding.position_step);
+    state.velocity[i] = dequantize(channels[4 + i], encoding.velocity_step);
+  }
+  const double s = encoding.attitude_step;
+  Eigen::Quaterniond q(dequantize(channels[7], s), dequantize(channels[8], s),
+                       dequantize(channels[9], s), dequantize(channels[10], s));
+  state.attitude = q.normalized().toRotationMatrix();
+}
+
+inline void put_varint(std::vector<unsigned char> &out, std::uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<unsigned char>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<unsigned char>(v));
+}
+
+inline std::uint64_t get_varint(const unsigned char *&in,
+                                const unsigned char *end) {
+  std::uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (in == end) throw std::runtime_error("truncated trajectory block");
+    const unsigned char byte = *in++;
+    v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return v;
+  }
+  throw std::runtime_error("malformed trajectory block");
+}
+
+inline std::uint64_t zigzag(std::uint64_t v) {
+  return (v << 1) ^ static_cast<std::uint64_t>(static_cast<std::int64_t>(v) >>
+                                               63);
+}
+
+inline std::uint64_t unzigzag(std::uint64_t v) {
+  return (v >> 1) ^ (~(v & 1) + 1);
+}
+
+//! Little-endian fixed-width fields
+template <class T>
+void put_fixed(std::ostream &out, T value) {
+  unsigned char bytes[sizeof(T)];
+  std::uint64_t u = 0;
+  std::memcpy(&u, &value, sizeof(T));
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = static_cast<unsigned char>(u >> (8 * i));
+  }
+  out.write(reinterpret_cast<const char *>(bytes), sizeof(T));
+}
+
+template <class T>
+T get_fixed(std::istream &in) {
+  unsigned char bytes[sizeof(T)];
+  if (!in.read(reinterpret_cast<char *>(bytes), sizeof(T))) {
+    throw std::runtime_error("truncated trajectory file");
+  }
+  std::uint64_t u = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    u |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+  }
+  T value;
+  std::memcpy(&value, &u, sizeof(T));
+  return value;
+}
+
+//! Location and extent of one block
+struct BlockIndex {
+  std::uint64_t offset;
+  std::uint64_t first_record;
+  double first_time;
+  std::uint32_t records;
+};
+
+//! Size of one BlockIndex entry in the file (fields packed, no padding)
+static constexpr std::uint64_t INDEX_ENTRY_BYTES = 8 + 8 + 8 + 4;
+
+}  // namespace detail
+
+/**
+ * @brief Writes states to a compact, block-indexed trajectory stream
+ *
+ * Layout: file header (magic, encoding), blocks of up to block_records
+ * delta-encoded records, then a block index (offset, first record, first time,
+ * record count) and a footer pointing to it. Call close() to write the final
+ * block and the index; the stream must stay open until then.
+ */
+class TrajectoryWriter {
+ public:
+  TrajectoryWriter(std::ostream &out,
+                   const TrajectoryEncoding &encoding = TrajectoryEncoding())
+      : out_(out),
+        encoding_(encoding),
+        channels_(detail::channel_count(encoding)),
+        records_(0),
+        block_records_(0),
+        previous_quaternion_(Vector4::Zero()),
+        closed_(false) {
+    if (encoding.block_records == 0 ||
+        encoding.block_records > detail::MAX_BLOCK_RECORDS ||
+        (encoding.mode == TrajectoryEncoding::QUANTIZED &&
+         !(encoding.time_step > 0 && encoding.position_step > 0 &&
+           encoding.velocity_step > 0 && encoding.attitude_step > 0))) {
+      throw std::invalid_argument("invalid trajectory encoding");
+    }
+    out_.write(detail::FILE_MAGIC, sizeof(detail::FILE_MAGIC));
+    detail::put_fixed<std::uint32_t>(out_, encoding_.mode);
+    detail::put_fixed<std::uint32_t>(out_, encoding_.block_records);
+    detail::put_fixed<double>(out_, encoding_.time_step);
+    detail::put_fixed<double>(out_, encoding_.position_step);
+    detail::put_fixed<double>(out_, encoding_.velocity_step);
+    detail::put_fixed<double>(out_, encoding_.attitude_step);
+  }
+  TrajectoryWriter(const TrajectoryWriter &) = delete;
+  TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! Writes the index if close() was not called (errors are discarded)
+  ~TrajectoryWriter() {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  //! Append one state
+  void write(const StatePvaSO3 &state) {
+    if (closed_) throw std::logic_error("trajectory writer is closed");
+    if (block_records_ == 0) {
+      index_.push_back(detail::BlockIndex{0, records_, state.time, 0});
+    }
+    std::uint64_t c[detail::MAX_CHANNELS];
+    detail::to_channels(encoding_, state, previous_quaternion_, c);
+    for (int i = 0; i < channels_; ++i) {
+      // Second difference, modulo 2^64
+      const std::uint64_t residual =
+          block_records_ == 0   ? c[i]
+          : block_records_ == 1 ? c[i] - prev_[i]
+                                : c[i] - 2 * prev_[i] + prev2_[i];
+      detail::put_varint(payload_, detail::zigzag(residual));
+      prev2_[i] = prev_[i];
+      prev_[i] = c[i];
+    }
+    ++records_;
+    if (++block_records_ == encoding_.block_records) flush_block();
+  }
+
+  //! Write any partial block, the block index, and the footer
+  void close() {
+    if (closed_) return;
+    closed_ = true;
+    flush_block();
+    const std::uint64_t index_offset = position();
+    out_.write(detail::INDEX_MAGIC, sizeof(detail::INDEX_MAGIC));
+    detail::put_fixed<std::uint64_t>(out_, index_.size());
+    for (const detail::BlockIndex &b : index_) {
+      detail::put_fixed<std::uint64_t>(out_, b.offset);
+      detail::put_fixed<std::uint64_t>(out_, b.first_record);
+      detail::put_fixed<double>(out_, b.first_time);
+      detail::put_fixed<std::uint32_t>(out_, b.records);
+    }
+    detail::put_fixed<std::uint64_t>(out_, index_offset);
+    out_.write(detail::INDEX_MAGIC, sizeof(detail::INDEX_MAGIC));
+    out_.flush();
+    if (!out_) throw std::runtime_error("failed writing trajectory file");
+  }
+
+  //! Number of states written
+  std::uint64_t records() const { return records_; }
+
+ private:
+  std::uint64_t position() {
+    const std::streamoff p = out_.tellp();
+    if (p < 0) throw std::runtime_error("trajectory stream is not seekable");
+    return static_cast<std::uint64_t>(p);
+  }
+
+  void flush_block() {
+    if (block_records_ == 0) return;
+    detail::BlockIndex &b = index_.back();
+    b.offset = position();
+    b.records = block_records_;
+    detail::put_fixed<std::uint32_t>(out_, block_records_);
+    detail::put_fixed<std::uint32_t>(
+        out_, static_cast<std::uint32_t>(payload_.size()));
+    out_.write(reinterpret_cast<const char *>(payload_.data()),
+               payload_.size());
+    if (!out_) throw std::runtime_error("failed writing trajectory file");
+    payload_.clear();
+    block_records_ = 0;
+    previous_quaternion_.setZero();
+  }
+
+  std::ostream &out_;
+  TrajectoryEncoding encoding_;
+  int channels_;
+  std::uint64_t records_;
+  std::uint32_t block_records_;
+  Vector4 previous_quaternion_;
+  bool closed_;
+  std::uint64_t prev_[detail::MAX_CHANNELS];
+  std::uint64_t prev2_[detail::MAX_CHANNELS];
+  std::vector<unsigned char> payload_;
+  std::vector<detail::BlockIndex> index_;
+};
+
+/**
+ * @brief Reads trajectory streams written by TrajectoryWriter
+ *
+ * Reads the block index on construction; read() then decodes one block at a
+ * time into memory. seek() and seek_time() jump to any record by loading only
+ * the block that holds it.
+ */
+class TrajectoryReader {
+ public:
+  explicit TrajectoryReader(std::istream &in)
+      : in_(in), records_(0), index_offset_(0), block_(0), next_(0) {
+    char magic[8];
+    if (!in_.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, detail::FILE_MAGIC, sizeof(magic)) != 0) {
+      throw std::runtime_error("not a trajectory file");
+    }
+    const std::uint32_t mode = detail::get_fixed<std::uint32_t>(in_);
+    if (mode > TrajectoryEncoding::QUANTIZED) {
+      throw std::runtime_error("unknown trajectory encoding");
+    }
+    encoding_.mode = static_cast<TrajectoryEncoding::Mode>(mode);
+    encoding_.block_records = detail::get_fixed<std::uint32_t>(in_);
+    if (encoding_.block_records == 0 ||
+        encoding_.block_records > detail::MAX_BLOCK_RECORDS) {
+      throw std::runtime_error("invalid trajectory block size");
+    }
+    encoding_.time_step = detail::get_fixed<double>(in_);
+    encoding_.position_step = detail::get_fixed<double>(in_);
+    encoding_.velocity_step = detail::get_fixed<double>(in_);
+    encoding_.attitude_step = detail::get_fixed<double>(in_);
+    channels_ = detail::channel_count(encoding_);
+
+    // Footer: index offset and magic
+    in_.seekg(-static_cast<std::streamoff>(16), std::ios::end);
+    const std::streamoff footer = in_.tellg();
+    const std::uint64_t index_offset = detail::get_fixed<std::uint64_t>(in_);
+    index_offset_ = index_offset;
+    if (!in_.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, detail::INDEX_MAGIC, sizeof(magic)) != 0) {
+      throw std::runtime_error("trajectory file has no index (not closed?)");
+    }
+    // Index header (magic and block count) must lie before the footer
+    if (footer < 16 || index_offset > static_cast<std::uint64_t>(footer - 16)) {
+      throw std::runtime_error("corrupt trajectory index");
+    }
+    in_.seekg(static_cast<std::streamoff>(index_offset));
+    if (!in_.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, detail::INDEX_MAGIC, sizeof(magic)) != 0) {
+      throw std::runtime_error("corrupt trajectory index");
+    }
+    const std::uint64_t blocks = detail::get_fixed<std::uint64_t>(in_);
+    // Checked before allocating: the count comes from the file
+    const std::uint64_t index_bytes =
+        static_cast<std::uint64_t>(footer - 16) - index_offset;
+    if (blocks > index_bytes / detail::INDEX_ENTRY_BYTES) {
+      throw std::runtime_error("corrupt trajectory index");
+    }
+    index_.resize(blocks);
+    for (detail::BlockIndex &b : index_) {
+      b.offset = detail::get_fixed<std::uint64_t>(in_);
+      b.first_record = detail::get_fixed<std::uint64_t>(in_);
+      b.first_time = detail::get_fixed<double>(in_);
+      b.records = detail::get_fixed<std::uint32_t>(in_);
+      if (b.records == 0 || b.records > encoding_.block_records) {
+        throw std::runtime_error("corrupt trajectory index");
+      }
+      records_ += b.records;
+    }
+  }
+
+  //! Encoding the file was written with
+  const TrajectoryEncoding &encoding() const { return encoding_; }
+
+  //! Number of states in the file
+  std::uint64_t records() const { return records_; }
+
+  //! Number of blocks in the file
+  std::size_t blocks() const { return index_.size(); }
+
+  /**
+   * @brief Read the next state
+   *
+   * @return false at the end of the file
+   */
+  bool read(StatePvaSO3 &state) {
+    if (next_ >= decoded_.size()) {
+      if (block_ >= index_.size()) return false;
+      load_block(block_++);
+      next_ = 0;
+    }
+    state = decoded_[next_++];
+    return true;
+  }
+
+  //! Position on a record number, so the next read() returns it
+  void seek(std::uint64_t record) {
+    if (record >= records_) {
+      block_ = index_.size();
+      decoded_.clear();
+      next_ = 0;
+      return;
+    }
+    std::size_t lo = 0, hi = index_.size() - 1;
+    while (lo < hi) {
+      const std::size_t mid = lo + (hi - lo + 1) / 2;
+      if (index_[mid].first_record <= record) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    load_block(lo);
+    block_ = lo + 1;
+    next_ = static_cast<std::size_t>(record - index_[lo].first_record);
+  }
+
+  /**
+   * @brief Position on the first record at or after a time
+   *
+   * Assumes time increases through the file.
+   */
+  void seek_time(double time) {
+    std::size_t b = 0;
+    while (b + 1 < index_.size() && index_[b + 1].first_time <= time) ++b;
+    if (index_.empty()) return;
+    load_block(b);
+    block_ = b + 1;
+    next_ = 0;
+    while (next_ < decoded_.size() && decoded_[next_].time < time) ++next_;
+  }
+
+ private:
+  void load_block(std::size_t b) {
+    const detail::BlockIndex &index = index_[b];
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(index.offset));
+    const std::uint32_t records = detail::get_fixed<std::uint32_t>(in_);
+    const std::uint32_t bytes = detail::get_fixed<std::uint32_t>(in_);
+    if (records != index.records) {
+      throw std::runtime_error("trajectory block does not match index");
+    }
+    // Blocks end where the index starts, and every varint takes at least a
+    // byte: checked before allocating, as both sizes come from the file
+    const std::uint64_t start = index.offset + 8;
+    if (start > index_offset_ || bytes > index_offset_ - start ||
+        static_cast<std::uint64_t>(records) * channels_ > bytes) {
+      throw std::runtime_error("corrupt trajectory block");
+    }
+    payload_.resize(bytes);
+    if (!in_.read(reinterpret_cast<char *>(payload_.data()), bytes)) {
+      throw std::runtime_error("truncated trajectory file");
+    }
+
+    decoded_.resize(records);
+    const unsigned char *p = payload_.data();
+    const unsigned char *end = p + payload_.size();
+    std::uint64_t prev[detail::MAX_CHANNELS], prev2[detail::MAX_CHANNELS];
+    std::uint64_t c[detail::MAX_CHANNELS];
+    for (std::uint32_t k = 0; k < records; ++k) {
+      for (int i = 0; i < channels_; ++i) {
+        const std::uint64_t residual =
+            detail::unzigzag(detail::get_varint(p, end));
+        c[i] = k == 0   ? residual
+               : k == 1 ? residual + prev[i]
+                        : residual + 2 * prev[i] - prev2[i];
+        prev2[i] = prev[i];
+        prev[i] = c[i];
+      }
+      detail::from_channels(encoding_, c, decoded_[k]);
+    }
+  }
+
+  std::istream &in_;
+  TrajectoryEncoding encoding_;
+  int channels_;
+  std::uint64_t records_;
+  std::uint64_t index_offset_;
+  std::vector<detail::BlockIndex> index_;
+  std::size_t block_;
+  std::vector<unsigned char> payload_;
+  std::vector<StatePvaSO3> decoded_;
+  std::size_t next_;
+};
+
+}  // namespace io
+}  // namespace ennui
@@ -0,0 +1,40 @@
+/**
+ * @file kernel_table.hpp
+ * @brief Function table shared by the instruction-set variants (internal)
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "ennui_types.hpp"
+
+namespace ennui {
+namespace kernels {
+
+//! One instruction-set variant of every kernel
+struct KernelTable {
+  void (*fwd_pva_S03)(const Vector3 &, const Vector3 &, const Matrix3x3 &,
+                      const Vector3 &, const Vector3 &, const Vector3 &, double,
+                      Vector3 &, Vector3 &, Matrix3x3 &);
+  void (*propagate)(StatePvaSO3 &, const ImuSample *, std::size_t,
+                    StatePvaSO3 *);
+  void (*gravitation_ecef)(const double *, double *, std::size_t);
+  void (*R3_to_SO3)(const double *, double *, std::size_t);
+  void (*position_geodetic_to_ecef)(const double *, double *, std::size_t);
+};
+
+// Defined in kernel_variants.cpp. Tables beyond BASELINE only exist when
+// ENNUI_KERNELS_X86_VARIANTS is set.
+namespace baseline {
+extern const KernelTable TABLE;
+}
+namespace avx2 {
+extern const KernelTable TABLE;
+}
+namespace avx512 {
+extern const KernelTable TABLE;
+}
+
+}  // namespace kernels
+}  // namespace ennui
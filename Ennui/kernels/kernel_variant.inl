@@ -0,0 +1,71 @@
+/**
+ * @file kernel_variant.inl
+ * @brief Kernel bodies, included once per instruction-set variant
+ *
+ * Included by kernel_variants.cpp inside a variant namespace with
+ * ENNUI_KERNEL_ATTR set to that variant's function attributes. The library
+ * templates are instantiated once, at the compiler's baseline, and flattened
+ * (fully inlined) into these wrappers, where they are compiled for the
+ * variant's instruction set. Out-of-line copies of the templates therefore
+ * never contain instructions the host may lack.
+ */
+
+ENNUI_KERNEL_ATTR
+static void fwd_pva_S03(const Vector3 &position_minus,
+                        const Vector3 &velocity_minus,
+                        const Matrix3x3 &attitude_minus,
+                        const Vector3 &gravitation,
+                        const Vector3 &specific_force,
+                        const Vector3 &angular_rate, double dt,
+                        Vector3 &position_plus, Vector3 &velocity_plus,
+                        Matrix3x3 &attitude_plus) {
+  mechanization::ecef::fwd_pva_S03_rt<geodetic::Wgs84>(
+      position_minus, velocity_minus, attitude_minus, gravitation,
+      specific_force, angular_rate, dt, position_plus, velocity_plus,
+      attitude_plus);
+}
+
+ENNUI_KERNEL_ATTR
+static void propagate(StatePvaSO3 &state, const ImuSample *samples,
+                      std::size_t count, StatePvaSO3 *history) {
+  for (std::size_t i = 0; i < count; ++i) {
+    const Vector3 gravitation =
+        geodetic::gravitation_ecef<geodetic::Wgs84>(state.position);
+    mechanization::ecef::fwd_pva_S03_rt<geodetic::Wgs84>(state, gravitation,
+                                                         samples[i], state);
+    if (history) history[i] = state;
+  }
+}
+
+ENNUI_KERNEL_ATTR
+static void gravitation_ecef(const double *positions, double *gravitation,
+                             std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    MapVector3(gravitation + 3 * i) =
+        geodetic::gravitation_ecef<geodetic::Wgs84>(
+            ConstMapVector3(positions + 3 * i));
+  }
+}
+
+ENNUI_KERNEL_ATTR
+static void R3_to_SO3(const double *vectors, double *matrices,
+                      std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    MapMatrix3x3(matrices + 9 * i) =
+        math::R3_to_SO3(ConstMapVector3(vectors + 3 * i));
+  }
+}
+
+ENNUI_KERNEL_ATTR
+static void position_geodetic_to_ecef(const double *positions_llh,
+                                      double *positions_ecef,
+                                      std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    MapVector3(positions_ecef + 3 * i) =
+        geodetic::position_geodetic_to_ecef<geodetic::Wgs84>(
+            ConstMapVector3(positions_llh + 3 * i));
+  }
+}
+
+extern const KernelTable TABLE = {&fwd_pva_S03, &propagate, &gravitation_ecef,
+                                  &R3_to_SO3, &position_geodetic_to_ecef};
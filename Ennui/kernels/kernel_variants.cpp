@@ -0,0 +1,39 @@
+/**
+ * @file kernel_variants.cpp
+ * @brief Instruction-set variants of the kernels (internal)
+ */
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "frame_transform.hpp"
+#include "gravitation.hpp"
+#include "kernel_table.hpp"
+#include "rotation.hpp"
+#include "wgs84.hpp"
+
+namespace ennui {
+namespace kernels {
+
+namespace baseline {
+#define ENNUI_KERNEL_ATTR
+#include "kernel_variant.inl"
+#undef ENNUI_KERNEL_ATTR
+}  // namespace baseline
+
+#ifdef ENNUI_KERNELS_X86_VARIANTS
+namespace avx2 {
+#define ENNUI_KERNEL_ATTR __attribute__((target("avx2,fma"), flatten))
+#include "kernel_variant.inl"
+#undef ENNUI_KERNEL_ATTR
+}  // namespace avx2
+
+namespace avx512 {
+#define ENNUI_KERNEL_ATTR \
+  __attribute__((target("avx512f,avx512dq,avx512vl,avx2,fma"), flatten))
+#include "kernel_variant.inl"
+#undef ENNUI_KERNEL_ATTR
+}  // namespace avx512
+#endif
+
+}  // namespace kernels
+}  // namespace ennui
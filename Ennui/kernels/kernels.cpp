@@ -0,0 +1,161 @@
+/**
+ * @file kernels.cpp
+ * @brief Run-time instruction-set dispatch for the precompiled kernels
+ */
+
+#include "kernels.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "kernel_table.hpp"
+
+namespace ennui {
+namespace kernels {
+
+namespace {
+
+const KernelTable &table_of(Isa isa) {
+#ifdef ENNUI_KERNELS_X86_VARIANTS
+  switch (isa) {
+    case Isa::AVX512:
+      return avx512::TABLE;
+    case Isa::AVX2:
+      return avx2::TABLE;
+    default:
+      break;
+  }
+#else
+  (void)isa;
+#endif
+  return baseline::TABLE;
+}
+
+Isa clamp(Isa isa) {
+  const Isa best = detected_isa();
+  return static_cast<int>(isa) > static_cast<int>(best) ? best : isa;
+}
+
+// Constant-initialized (null) and filled in on first use, so kernels called
+// from static initializers of other translation units select the ISA then,
+// instead of finding a table that is not initialized yet.
+std::atomic<const KernelTable *> table(nullptr);
+
+const KernelTable &initialize() {
+  const KernelTable *expected = nullptr;
+  const KernelTable *selected = &table_of(default_isa());
+  if (table.compare_exchange_strong(expected, selected)) return *selected;
+  return *expected;  // select_isa() or another thread was first
+}
+
+inline const KernelTable &current() {
+  const KernelTable *t = table.load(std::memory_order_relaxed);
+  return t != nullptr ? *t : initialize();
+}
+
+}  // namespace
+
+const char *isa_name(Isa isa) {
+  switch (isa) {
+    case Isa::AVX512:
+      return "avx512";
+    case Isa::AVX2:
+      return "avx2";
+    default:
+      return "baseline";
+  }
+}
+
+bool parse_isa(const char *name, Isa &isa) {
+  if (!name) return false;
+  const Isa all[] = {Isa::BASELINE, Isa::AVX2, Isa::AVX512};
+  for (const Isa candidate : all) {
+    if (std::strcmp(name, isa_name(candidate)) == 0) {
+      isa = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+Isa detected_isa() {
+#ifdef ENNUI_KERNELS_X86_VARIANTS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma")) {
+    return Isa::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return Isa::AVX2;
+  }
+#endif
+  return Isa::BASELINE;
+}
+
+Isa default_isa() {
+  Isa isa = detected_isa();
+  parse_isa(std::getenv("ENNUI_ISA"), isa);
+  return clamp(isa);
+}
+
+Isa active_isa() {
+  const KernelTable *t = &current();
+  // Baseline first: without x86 variants every ISA maps to its table
+  const Isa all[] = {Isa::BASELINE, Isa::AVX2, Isa::AVX512};
+  for (const Isa isa : all) {
+    if (t == &table_of(isa)) return isa;
+  }
+  return Isa::BASELINE;
+}
+
+Isa select_isa(Isa isa) {
+  isa = clamp(isa);
+  table.store(&table_of(isa));
+  return isa;
+}
+
+void fwd_pva_S03(const Vector3 &position_minus, const Vector3 &velocity_minus,
+                 const Matrix3x3 &attitude_minus, const Vector3 &gravitation,
+                 const Vector3 &specific_force, const Vector3 &angular_rate,
+                 double dt, Vector3 &position_plus, Vector3 &velocity_plus,
+                 Matrix3x3 &attitude_plus) {
+  current().fwd_pva_S03(position_minus, velocity_minus, attitude_minus,
+                        gravitation, specific_force, angular_rate, dt,
+                        position_plus, velocity_plus, attitude_plus);
+}
+
+void propagate(StatePvaSO3 &state, const ImuSample *samples,
+               std::size_t count, StatePvaSO3 *history) {
+  current().propagate(state, samples, count, history);
+}
+
+Vector3 gravitation_ecef(const Vector3 &position) {
+  Vector3 gravitation;
+  current().gravitation_ecef(position.data(), gravitation.data(), 1);
+  return gravitation;
+}
+
+void gravitation_ecef(const double *positions, double *gravitation,
+                      std::size_t count) {
+  current().gravitation_ecef(positions, gravitation, count);
+}
+
+Matrix3x3 R3_to_SO3(const Vector3 &x) {
+  Matrix3x3 rslt;
+  current().R3_to_SO3(x.data(), rslt.data(), 1);
+  return rslt;
+}
+
+void R3_to_SO3(const double *vectors, double *matrices, std::size_t count) {
+  current().R3_to_SO3(vectors, matrices, count);
+}
+
+void position_geodetic_to_ecef(const double *positions_llh,
+                               double *positions_ecef, std::size_t count) {
+  current().position_geodetic_to_ecef(positions_llh, positions_ecef, count);
+}
+
+}  // namespace kernels
+}  // namespace ennui
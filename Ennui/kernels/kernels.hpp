@@ -0,0 +1,128 @@
+/**
+ * @file kernels.hpp
+ * @brief Precompiled hot kernels with run-time instruction-set dispatch
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "ennui_types.hpp"
+
+namespace ennui {
+namespace kernels {
+
+/**
+ * @brief Instruction-set variants compiled into the kernel library
+ *
+ * Ordered from least to most capable. Only BASELINE is available outside of
+ * x86 with GCC or Clang.
+ */
+enum class Isa : int {
+  BASELINE = 0,  //!< compiler default for the target (e.g. x86-64 SSE2)
+  AVX2 = 1,      //!< AVX2 and FMA
+  AVX512 = 2     //!< AVX-512 F/DQ/VL, plus AVX2 and FMA
+};
+
+//! Lower-case name of a variant: "baseline", "avx2", or "avx512"
+const char *isa_name(Isa isa);
+
+/**
+ * @brief Parse a variant name as accepted by the ENNUI_ISA variable
+ *
+ * @param[in] name variant name, see isa_name()
+ * @param[out] isa parsed variant, unchanged on failure
+ * @return false if the name is not recognized
+ */
+bool parse_isa(const char *name, Isa &isa);
+
+//! Most capable variant supported by the host CPU (CPUID)
+Isa detected_isa();
+
+/**
+ * @brief Variant selected on the first kernel call
+ *
+ * The detected variant, unless the ENNUI_ISA environment variable names a
+ * variant (e.g. ENNUI_ISA=baseline). Requests beyond the host's capability are
+ * clamped to detected_isa().
+ */
+Isa default_isa();
+
+//! Variant currently used by the kernels
+Isa active_isa();
+
+/**
+ * @brief Switch the variant used by the kernels (e.g. for testing)
+ *
+ * @param isa requested variant, clamped to detected_isa()
+ * @return variant actually selected
+ *
+ * Not synchronized with kernels executing on other threads: callers on other
+ * threads observe the switch at their next kernel call.
+ */
+Isa select_isa(Isa isa);
+
+/**
+ * @brief Forward propagation of mean state in ECEF reference frame (WGS84)
+ *
+ * Dispatched mechanization::ecef::fwd_pva_S03_rt for geodetic::Wgs84. Outputs
+ * may alias inputs.
+ */
+void fwd_pva_S03(const Vector3 &position_minus, const Vector3 &velocity_minus,
+                 const Matrix3x3 &attitude_minus, const Vector3 &gravitation,
+                 const Vector3 &specific_force, const Vector3 &angular_rate,
+                 double dt, Vector3 &position_plus, Vector3 &velocity_plus,
+                 Matrix3x3 &attitude_plus);
+
+/**
+ * @brief Propagate a state through a sequence of IMU samples (WGS84)
+ *
+ * @param[in,out] state prior state, replaced by the final state
+ * @param[in] samples count IMU samples
+ * @param[in] count number of samples
+ * @param[out] history optional (may be null) destination for the count
+ * intermediate states
+ *
+ * Gravitation is evaluated at the prior position of each step.
+ */
+void propagate(StatePvaSO3 &state, const ImuSample *samples,
+               std::size_t count, StatePvaSO3 *history);
+
+//! Dispatched geodetic::gravitation_ecef for geodetic::Wgs84
+Vector3 gravitation_ecef(const Vector3 &position);
+
+/**
+ * @brief Batched geodetic::gravitation_ecef for geodetic::Wgs84
+ *
+ * @param[in] positions count ECEF positions, 3 contiguous doubles each
+ * @param[out] gravitation count gravitation vectors, 3 contiguous doubles each
+ * @param[in] count number of positions
+ */
+void gravitation_ecef(const double *positions, double *gravitation,
+                      std::size_t count);
+
+//! Dispatched math::R3_to_SO3
+Matrix3x3 R3_to_SO3(const Vector3 &x);
+
+/**
+ * @brief Batched math::R3_to_SO3
+ *
+ * @param[in] vectors count rotation vectors, 3 contiguous doubles each
+ * @param[out] matrices count rotation matrices, 9 contiguous doubles each in
+ * the storage order of Matrix3x3
+ * @param[in] count number of rotation vectors
+ */
+void R3_to_SO3(const double *vectors, double *matrices, std::size_t count);
+
+/**
+ * @brief Batched geodetic::position_geodetic_to_ecef for geodetic::Wgs84
+ *
+ * @param[in] positions_llh count positions as (lat [deg], lon [deg], h [m])
+ * @param[out] positions_ecef count ECEF positions, 3 contiguous doubles each
+ * @param[in] count number of positions
+ */
+void position_geodetic_to_ecef(const double *positions_llh,
+                               double *positions_ecef, std::size_t count);
+
+}  // namespace kernels
+}  // namespace ennui
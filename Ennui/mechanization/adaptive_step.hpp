@@ -0,0 +1,228 @@
+/**
+ * @file adaptive_step.hpp
+ * @brief Adaptive aggregation of IMU samples into larger mechanization steps
+ */
+
+#pragma once
+#include <math.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+
+namespace ennui {
+namespace mechanization {
+namespace ecef {
+
+/**
+ * @brief Limits on merging IMU samples into one step
+ *
+ * Merging replaces the samples by their time-weighted mean, which preserves
+ * the integrated rotation vector and velocity increment but not how they are
+ * distributed within the step. The rate-change limits bound that
+ * redistribution: the spread (max - min, per axis) of the merged rates times
+ * the merged interval. The attitude estimate also includes the first-order
+ * Earth-rate coupling of fwd_pva_S03, |omega_ie| dt |alpha|. The alpha limit
+ * bounds the rotation of one merged step (see the alpha branches in
+ * rotation.hpp).
+ *
+ * Limits apply per merged step; the error against full-rate propagation
+ * accumulates over steps, mostly as attitude error tilting the specific force.
+ */
+struct AdaptiveStepTolerance {
+  //! Angular-rate spread times step length, plus Earth-rate coupling [rad]
+  double angular_rate_change = 1e-6;
+  //! Specific-force spread times step length [m/s]
+  double specific_force_change = 1e-4;
+  //! Rotation of one merged step, |alpha| [rad]
+  double alpha = 1e-2;
+  //! Longest merged step [s]
+  double max_dt = 0.1;
+  //! Most samples per merged step
+  std::size_t max_samples = 100;
+};
+
+/**
+ * @brief ECEF propagation that merges samples while the motion is benign
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * Samples are accumulated until adding the next one would exceed a limit of
+ * AdaptiveStepTolerance; the accumulated samples are then propagated as one
+ * step of fwd_pva_S03_rt (gravitation at the prior position). During
+ * maneuvers the rate-change limits are hit at every sample and propagation
+ * falls back to the full IMU rate.
+ */
+template <class GeodeMdl>
+class AdaptiveStepper {
+ public:
+  explicit AdaptiveStepper(
+      const StatePvaSO3 &initial,
+      const AdaptiveStepTolerance &tolerance = AdaptiveStepTolerance())
+      : tolerance_(tolerance), state_(initial), samples_(0), steps_(0) {
+    clear();
+  }
+
+  //! Add one sample, propagating the pending samples first if it cannot merge
+  void push(const ImuSample &sample) {
+    if (pending_ > 0 && !mergeable(sample)) flush();
+    accumulate(sample);
+    ++samples_;
+  }
+
+  //! Propagate the pending samples, if any
+  void flush() {
+    if (pending_ == 0) return;
+    ImuSample merged;
+    merged.time = time_;
+    merged.dt = dt_;
+    merged.specific_force = velocity_increment_ / dt_;
+    merged.angular_rate = rotation_increment_ / dt_;
+    fwd_pva_S03_rt<GeodeMdl>(
+        state_, geodetic::gravitation_ecef<GeodeMdl>(state_.position), merged,
+        state_);
+    ++steps_;
+    clear();
+  }
+
+  //! State after the last propagated step
+  const StatePvaSO3 &state() const { return state_; }
+  //! Samples pushed
+  std::uint64_t samples() const { return samples_; }
+  //! Mechanization steps run
+  std::uint64_t steps() const { return steps_; }
+  //! Samples awaiting propagation
+  std::size_t pending() const { return pending_; }
+  //! Samples per mechanization step
+  double reduction() const {
+    return steps_ > 0 ? static_cast<double>(samples_ - pending_) / steps_
+                      : 1.0;
+  }
+
+ private:
+  void clear() {
+    pending_ = 0;
+    dt_ = 0.0;
+    velocity_increment_.setZero();
+    rotation_increment_.setZero();
+  }
+
+  bool mergeable(const ImuSample &sample) const {
+    if (pending_ >= tolerance_.max_samples) return false;
+    const double dt = dt_ + sample.dt;
+    if (dt > tolerance_.max_dt) return false;
+    const double alpha =
+        (rotation_increment_ + sample.angular_rate * sample.dt).norm();
+    if (alpha > tolerance_.alpha) return false;
+    const Vector3 rate_spread =
+        rate_max_.cwiseMax(sample.angular_rate) -
+        rate_min_.cwiseMin(sample.angular_rate);
+    const double attitude_error =
+        (rate_spread.norm() + GeodeMdl::EARTH_ROTATION_RATE * alpha) * dt;
+    if (attitude_error > tolerance_.angular_rate_change) return false;
+    const Vector3 force_spread =
+        force_max_.cwiseMax(sample.specific_force) -
+        force_min_.cwiseMin(sample.specific_force);
+    return force_spread.norm() * dt <= tolerance_.specific_force_change;
+  }
+
+  void accumulate(const ImuSample &sample) {
+    if (pending_ == 0) {
+      rate_min_ = rate_max_ = sample.angular_rate;
+      force_min_ = force_max_ = sample.specific_force;
+    } else {
+      rate_min_ = rate_min_.cwiseMin(sample.angular_rate);
+      rate_max_ = rate_max_.cwiseMax(sample.angular_rate);
+      force_min_ = force_min_.cwiseMin(sample.specific_force);
+      force_max_ = force_max_.cwiseMax(sample.specific_force);
+    }
+    velocity_increment_ += sample.specific_force * sample.dt;
+    rotation_increment_ += sample.angular_rate * sample.dt;
+    dt_ += sample.dt;
+    time_ = sample.time;
+    ++pending_;
+  }
+
+  AdaptiveStepTolerance tolerance_;
+  StatePvaSO3 state_;
+  std::uint64_t samples_;
+  std::uint64_t steps_;
+  // Pending merged step
+  std::size_t pending_;
+  double time_;
+  double dt_;
+  Vector3 velocity_increment_;
+  Vector3 rotation_increment_;
+  Vector3 rate_min_, rate_max_;
+  Vector3 force_min_, force_max_;
+};
+
+//! Step reduction and error of adaptive against full-rate propagation
+struct AdaptiveStepReport {
+  std::uint64_t samples = 0;
+  std::uint64_t steps = 0;
+  //! Largest position difference along the trajectory [m]
+  double position_error = 0.0;
+  //! Largest velocity difference along the trajectory [m/s]
+  double velocity_error = 0.0;
+  //! Largest attitude difference (Frobenius norm) along the trajectory
+  double attitude_error = 0.0;
+
+  double reduction() const {
+    return steps > 0 ? static_cast<double>(samples) / steps : 1.0;
+  }
+};
+
+/**
+ * @brief Run adaptive and full-rate propagation side by side
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in] initial initial state
+ * @param[in] samples count IMU samples
+ * @param[in] count number of samples
+ * @param[in] tolerance merging limits
+ * @return reduction in steps and the largest differences, compared at the end
+ * of every merged step
+ */
+template <class GeodeMdl>
+AdaptiveStepReport evaluate_adaptive_step(
+    const StatePvaSO3 &initial, const ImuSample *samples, std::size_t count,
+    const AdaptiveStepTolerance &tolerance = AdaptiveStepTolerance()) {
+  AdaptiveStepper<GeodeMdl> adaptive(initial, tolerance);
+  StatePvaSO3 full = initial;
+  AdaptiveStepReport report;
+  std::uint64_t compared = 0;
+  // A step completed by push(samples[i]) ends where full rate stands before
+  // sample i is applied
+  auto compare = [&]() {
+    if (adaptive.steps() == compared) return;
+    compared = adaptive.steps();
+    const StatePvaSO3 &a = adaptive.state();
+    report.position_error = (std::max)(report.position_error,
+                                       (a.position - full.position).norm());
+    report.velocity_error = (std::max)(report.velocity_error,
+                                       (a.velocity - full.velocity).norm());
+    report.attitude_error = (std::max)(report.attitude_error,
+                                       (a.attitude - full.attitude).norm());
+  };
+  for (std::size_t i = 0; i < count; ++i) {
+    adaptive.push(samples[i]);
+    compare();
+    fwd_pva_S03_rt<GeodeMdl>(
+        full, geodetic::gravitation_ecef<GeodeMdl>(full.position), samples[i],
+        full);
+  }
+  adaptive.flush();
+  compare();
+  report.samples = adaptive.samples();
+  report.steps = adaptive.steps();
+  return report;
+}
+
+}  // namespace ecef
+}  // namespace mechanization
+}  // namespace ennui
@@ -0,0 +1,230 @@
+/**
+ * @file attitude_scan.hpp
+ * @brief Parallel-prefix (scan) propagation of long IMU logs, offline
+ */
+
+#pragma once
+#include <math.h>
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+#include "rotation.hpp"
+
+#ifdef ENNUI_CORE
+#include "wgs84.hpp"
+#endif
+
+namespace ennui {
+namespace mechanization {
+namespace ecef {
+
+//! Settings of the parallel scan
+struct AttitudeScanConfig {
+  std::size_t threads = 0;  //!< worker threads, 0 for all hardware threads
+  std::size_t normalize_every = 64;  //!< renormalize running products
+};
+
+namespace detail {
+
+//! Number of workers: one chunk each, never more than the samples
+inline std::size_t scan_workers(const AttitudeScanConfig &config,
+                                std::size_t count) {
+  std::size_t workers = config.threads;
+  if (workers == 0) workers = std::thread::hardware_concurrency();
+  if (workers == 0) workers = 1;
+  if (workers > count) workers = count;
+  return workers == 0 ? 1 : workers;
+}
+
+//! Call task(chunk, begin, end) for each of workers contiguous chunks
+template <class Task>
+void scan_chunks(std::size_t workers, std::size_t count, const Task &task) {
+  std::vector<std::thread> threads;
+  for (std::size_t c = 1; c < workers; ++c) {
+    threads.emplace_back(
+        [&task, c, workers, count]() {
+          task(c, c * count / workers, (c + 1) * count / workers);
+        });
+  }
+  task(0, 0, count / workers);
+  for (std::thread &t : threads) t.join();
+}
+
+//! Rotation of the ECEF frame over elapsed time, Rz(-omega t)
+template <class GeodeMdl>
+Matrix3x3 earth_rotation(double elapsed) {
+  const double angle = GeodeMdl::EARTH_ROTATION_RATE * elapsed;
+  const double c = cos(angle), s = sin(angle);
+  Matrix3x3 R;
+  R << c, s, 0, -s, c, 0, 0, 0, 1;
+  return R;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Attitude after every sample of a log, by a parallel scan
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in] attitude_initial body-to-ECEF attitude before the first sample
+ * @param[in] samples inertial measurements
+ * @param[in] count number of samples
+ * @param[out] attitudes count attitudes, the one after each sample
+ * @param[in] config threads and renormalization interval
+ *
+ * The body increments R_k = R3_to_SO3(angular_rate_k dt_k) and the Earth
+ * rotation commute across the product, so the attitude after n samples is
+ *
+ *   C_n = Rz(-omega T_n) C_0 R_1 R_2 ... R_n,    T_n = dt_1 + ... + dt_n,
+ *
+ * the form noted next to Eq. (5.75) in fwd_pva_S03_rt. The prefix products
+ * of R_k are associative, and are formed by a three-phase scan: each thread
+ * forms the running product of its chunk, the chunk totals are combined
+ * serially, and each thread then applies the product of the preceding chunks
+ * to its own. Running products are renormalized with normalize_SO3_Groves
+ * every config.normalize_every samples.
+ *
+ * The Earth-rate term is applied exactly rather than to first order, so the
+ * result differs from a chain of fwd_pva_S03_rt steps by the second-order
+ * coupling of body and Earth rates (see the unit tests for the size).
+ */
+template <class GeodeMdl>
+void scan_attitude(const Matrix3x3 &attitude_initial,
+                   const ImuSample *samples, std::size_t count,
+                   Matrix3x3 *attitudes,
+                   const AttitudeScanConfig &config = AttitudeScanConfig()) {
+  if (count == 0) return;
+  const std::size_t workers = detail::scan_workers(config, count);
+  const std::size_t every =
+      config.normalize_every == 0 ? count : config.normalize_every;
+  std::vector<Matrix3x3> totals(workers);
+  std::vector<double> durations(workers);
+  std::vector<double> elapsed(count);
+
+  // Phase 1: per-chunk running products of the body increments
+  detail::scan_chunks(
+      workers, count,
+      [&](std::size_t c, std::size_t begin, std::size_t end) {
+        Matrix3x3 product = Matrix3x3::Identity();
+        double duration = 0;
+        for (std::size_t k = begin; k < end; ++k) {
+          const ImuSample &s = samples[k];
+          product = product * math::R3_to_SO3(s.angular_rate * s.dt);
+          if ((k - begin + 1) % every == 0) {
+            product = math::normalize_SO3_Groves(product);
+          }
+          duration += s.dt;
+          attitudes[k] = product;
+          elapsed[k] = duration;
+        }
+        totals[c] = product;
+        durations[c] = duration;
+      });
+
+  // Phase 2: exclusive scan of the chunk totals
+  std::vector<Matrix3x3> carry(workers);
+  std::vector<double> start(workers);
+  carry[0] = attitude_initial;
+  start[0] = 0;
+  for (std::size_t c = 1; c < workers; ++c) {
+    carry[c] = math::normalize_SO3_Groves(carry[c - 1] * totals[c - 1]);
+    start[c] = start[c - 1] + durations[c - 1];
+  }
+
+  // Phase 3: apply the preceding chunks and the Earth rotation
+  detail::scan_chunks(
+      workers, count,
+      [&](std::size_t c, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+          attitudes[k] =
+              detail::earth_rotation<GeodeMdl>(start[c] + elapsed[k]) *
+              (carry[c] * attitudes[k]);
+        }
+      });
+}
+
+/**
+ * @brief Full state after every sample of a log, attitude by parallel scan
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in] initial state before the first sample
+ * @param[in] samples inertial measurements
+ * @param[in] count number of samples
+ * @param[out] states count states, the one after each sample
+ * @param[in] config threads and renormalization interval
+ *
+ * Attitudes come from scan_attitude(). With all attitudes known, the specific
+ * force of each step is resolved in ECEF in parallel blocks, using the mean
+ * attitude over the step (Eq. (5.85) \cite groves_principles_2013). Velocity
+ * and position then follow in one serial pass, since gravitation depends on
+ * the position: that pass is the remainder of fwd_pva_S03_rt, with the
+ * attitude work already done.
+ */
+template <class GeodeMdl>
+void scan_pva(const StatePvaSO3 &initial, const ImuSample *samples,
+              std::size_t count, StatePvaSO3 *states,
+              const AttitudeScanConfig &config = AttitudeScanConfig()) {
+  if (count == 0) return;
+  std::vector<Matrix3x3> attitudes(count);
+  scan_attitude<GeodeMdl>(initial.attitude, samples, count, attitudes.data(),
+                          config);
+
+  const Matrix3x3 Omega =
+      math::R3_to_so3({0, 0, GeodeMdl::EARTH_ROTATION_RATE});
+  std::vector<Vector3> specific_force(count);
+  detail::scan_chunks(
+      detail::scan_workers(config, count), count,
+      [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+          const ImuSample &s = samples[k];
+          const Matrix3x3 &minus =
+              k == 0 ? initial.attitude : attitudes[k - 1];
+          const Vector3 alpha = s.angular_rate * s.dt;
+          const double alpha_norm = alpha.stableNorm();
+          const Matrix3x3 alpha_cross = math::R3_to_so3(alpha);
+          const Matrix3x3 Rb_mean =
+              alpha_norm > 1e-10
+                  ? math::mean_attitude_update(alpha_cross, alpha_norm)
+                  : math::mean_attitude_update_approx(alpha_cross,
+                                                      alpha_norm);
+          const Matrix3x3 Reb_mean =
+              minus * Rb_mean - 0.5 * s.dt * Omega * minus;
+          specific_force[k] = Reb_mean * s.specific_force;
+        }
+      });
+
+  Vector3 position = initial.position;
+  Vector3 velocity = initial.velocity;
+  for (std::size_t k = 0; k < count; ++k) {
+    const double dt = samples[k].dt;
+    const Vector3 ae_eb = specific_force[k] +
+                          geodetic::gravitation_ecef<GeodeMdl>(position) -
+                          Omega * Omega * position - 2 * Omega * velocity;
+    const Vector3 velocity_plus = velocity + ae_eb * dt;
+    position = position + 0.5 * dt * (2 * velocity_plus - ae_eb * dt);
+    velocity = velocity_plus;
+    states[k].time = samples[k].time;
+    states[k].position = position;
+    states[k].velocity = velocity;
+    states[k].attitude = attitudes[k];
+  }
+}
+
+#ifdef ENNUI_CORE
+// Precompiled in Ennui::core
+extern template void scan_attitude<geodetic::Wgs84>(
+    const Matrix3x3 &attitude_initial, const ImuSample *samples,
+    std::size_t count, Matrix3x3 *attitudes,
+    const AttitudeScanConfig &config);
+extern template void scan_pva<geodetic::Wgs84>(
+    const StatePvaSO3 &initial, const ImuSample *samples, std::size_t count,
+    StatePvaSO3 *states, const AttitudeScanConfig &config);
+#endif
+
+}  // namespace ecef
+}  // namespace mechanization
+}  // namespace ennui
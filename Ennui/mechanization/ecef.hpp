@@ -9,13 +9,18 @@
 #include "ennui_types.hpp"
 #include "rotation.hpp"
 
+#ifdef ENNUI_CORE
+#include "wgs84.hpp"
+#endif
+
 namespace ennui {
 
 namespace mechanization {
 namespace ecef {
 
 /**
- * @brief Forward propagation of mean state in ECEF reference frame
+ * @brief Forward propagation of mean state in ECEF reference frame, real-time
+ * safe
  *
  * @tparam GeodeMdl geodetic model
  * @param[in] position_minus prior position as 3-vector
@@ -30,16 +35,22 @@ namespace ecef {
  * @param[out] velocity_plus propagated velocity as 3-vector
  * @param[out] attitude_plus propagated attitude as 3x3 matrix
  *
+ * Same equations as fwd_pva_S03, restricted to the library's fixed-size types
+ * so that no argument can be converted through a temporary. All intermediates
+ * are fixed-size and on the stack: the step never touches the heap and never
+ * throws. Outputs are written last, so they may alias the inputs (in-place
+ * update).
+ *
  * See Section 5.5.1 in \cite groves_principles_2013.
  */
 template <class GeodeMdl>
-void fwd_pva_S03(ConstRefVector3 &position_minus,
-                 ConstRefVector3 &velocity_minus,
-                 const Eigen::Ref<const Matrix3x3> &attitude_minus,
-                 ConstRefVector3 &gravitation, ConstRefVector3 &specific_force,
-                 ConstRefVector3 &angular_rate, double dt,
-                 RefVector3 position_plus, RefVector3 velocity_plus,
-                 Eigen::Ref<Matrix3x3> attitude_plus) {
+void fwd_pva_S03_rt(const Vector3 &position_minus,
+                    const Vector3 &velocity_minus,
+                    const Matrix3x3 &attitude_minus,
+                    const Vector3 &gravitation, const Vector3 &specific_force,
+                    const Vector3 &angular_rate, double dt,
+                    Vector3 &position_plus, Vector3 &velocity_plus,
+                    Matrix3x3 &attitude_plus) noexcept {
   const Matrix3x3 Omega =
       math::R3_to_so3({0, 0, GeodeMdl::EARTH_ROTATION_RATE});
 
@@ -51,12 +62,13 @@ void fwd_pva_S03(ConstRefVector3 &position_minus,
   // Propagate attitude
   //
   // Eq. (5.75) \cite groves_principles_2013
-  attitude_plus = attitude_minus * Rb_prop - dt * Omega * attitude_minus;
+  Matrix3x3 attitude =
+      attitude_minus * Rb_prop - dt * Omega * attitude_minus;
   // TODO : Alternative derivation?!?
   // attitude_plus = math::R3_to_SO3({0, 0, -dt *
   // Wgs84::EARTH_ROTATION_RATE}) *
   //                attitude_minus * Rb_prop;
-  attitude_plus = math::normalize_SO3_Groves(attitude_plus);
+  attitude = math::normalize_SO3_Groves(attitude);
 
   // Specific force update
   //
@@ -83,11 +95,90 @@ void fwd_pva_S03(ConstRefVector3 &position_minus,
   // Eq. (5.36), using Eq. (2.132) \cite groves_principles_2013
   const Vector3 ae_eb = fe_ib + gravitation - Omega * Omega * position_minus -
                         2 * Omega * velocity_minus;
-  velocity_plus = velocity_minus + ae_eb * dt;
+  const Vector3 velocity = velocity_minus + ae_eb * dt;
   // Eq. (5.38) \cite groves_principles_2013
-  position_plus = position_minus + 0.5 * dt * (2 * velocity_plus - ae_eb * dt);
+  position_plus = position_minus + 0.5 * dt * (2 * velocity - ae_eb * dt);
+  velocity_plus = velocity;
+  attitude_plus = attitude;
+}
+
+/**
+ * @brief Forward propagation of a state by one IMU sample, real-time safe
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in] minus prior state
+ * @param[in] gravitation gravitation as 3-vector
+ * @param[in] imu inertial measurement; its time stamps the propagated state
+ * @param[out] plus propagated state, may be the same object as minus
+ */
+template <class GeodeMdl>
+void fwd_pva_S03_rt(const StatePvaSO3 &minus, const Vector3 &gravitation,
+                    const ImuSample &imu, StatePvaSO3 &plus) noexcept {
+  fwd_pva_S03_rt<GeodeMdl>(minus.position, minus.velocity, minus.attitude,
+                           gravitation, imu.specific_force, imu.angular_rate,
+                           imu.dt, plus.position, plus.velocity,
+                           plus.attitude);
+  plus.time = imu.time;
+}
+
+/**
+ * @brief Forward propagation of mean state in ECEF reference frame
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in] position_minus prior position as 3-vector
+ * @param[in] velocity_minus prior velocity as 3-vector
+ * @param[in] attitude_minus prior attitude as 3x3 matrix
+ * @param[in] gravitation gravitation as 3-vector
+ * @param[in] specific_force specific force measurement ($Delta v$) as 3-vector
+ * @param[in] angular_rate angular force measurement ($\Delta \theta$) as
+ * 3-vector
+ * @param[in] dt timestep scalar
+ * @param[out] position_plus propagated position as 3-vector
+ * @param[out] velocity_plus propagated velocity as 3-vector
+ * @param[out] attitude_plus propagated attitude as 3x3 matrix
+ *
+ * Accepts any Eigen expression with compatible size. Arguments are copied to
+ * fixed-size values and forwarded to fwd_pva_S03_rt.
+ *
+ * See Section 5.5.1 in \cite groves_principles_2013.
+ */
+template <class GeodeMdl>
+void fwd_pva_S03(ConstRefVector3 &position_minus,
+                 ConstRefVector3 &velocity_minus,
+                 const Eigen::Ref<const Matrix3x3> &attitude_minus,
+                 ConstRefVector3 &gravitation, ConstRefVector3 &specific_force,
+                 ConstRefVector3 &angular_rate, double dt,
+                 RefVector3 position_plus, RefVector3 velocity_plus,
+                 Eigen::Ref<Matrix3x3> attitude_plus) {
+  Vector3 position, velocity;
+  Matrix3x3 attitude;
+  fwd_pva_S03_rt<GeodeMdl>(position_minus, velocity_minus, attitude_minus,
+                           gravitation, specific_force, angular_rate, dt,
+                           position, velocity, attitude);
+  position_plus = position;
+  velocity_plus = velocity;
+  attitude_plus = attitude;
 }
 
+#ifdef ENNUI_CORE
+// Precompiled in Ennui::core
+extern template void fwd_pva_S03_rt<geodetic::Wgs84>(
+    const Vector3 &position_minus, const Vector3 &velocity_minus,
+    const Matrix3x3 &attitude_minus, const Vector3 &gravitation,
+    const Vector3 &specific_force, const Vector3 &angular_rate, double dt,
+    Vector3 &position_plus, Vector3 &velocity_plus,
+    Matrix3x3 &attitude_plus) noexcept;
+extern template void fwd_pva_S03_rt<geodetic::Wgs84>(
+    const StatePvaSO3 &minus, const Vector3 &gravitation,
+    const ImuSample &imu, StatePvaSO3 &plus) noexcept;
+extern template void fwd_pva_S03<geodetic::Wgs84>(
+    ConstRefVector3 &position_minus, ConstRefVector3 &velocity_minus,
+    const Eigen::Ref<const Matrix3x3> &attitude_minus,
+    ConstRefVector3 &gravitation, ConstRefVector3 &specific_force,
+    ConstRefVector3 &angular_rate, double dt, RefVector3 position_plus,
+    RefVector3 velocity_plus, Eigen::Ref<Matrix3x3> attitude_plus);
+#endif
+
 }  // namespace ecef
 }  // namespace mechanization
 }  // namespace ennui
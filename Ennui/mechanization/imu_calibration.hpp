@@ -0,0 +1,178 @@
+/**
+ * @file imu_calibration.hpp
+ * @brief IMU calibration (bias, scale factor, misalignment) applied inline
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+
+#ifdef ENNUI_CORE
+#include "wgs84.hpp"
+#endif
+
+namespace ennui {
+namespace mechanization {
+
+//! Gyro and accelerometer biases, in the units of the measurements
+struct ImuBias {
+  Vector3 gyro = Vector3::Zero();   //!< angular rate bias [rad/s]
+  Vector3 accel = Vector3::Zero();  //!< specific force bias [m/s^2]
+};
+
+/**
+ * @brief IMU error model used to correct raw measurements
+ *
+ * Measurements are modelled as
+ *
+ *   measured = bias + (I + M) * true,
+ *
+ * with scale factors on the diagonal of M and misalignments (cross-coupling)
+ * off the diagonal, for the gyro and the accelerometer triad separately
+ * (Eqs. (4.16) and (4.17) \cite groves_principles_2013). The correction
+ * matrices (I + M)^-1 are computed once, at construction; set_bias() only
+ * replaces the biases, so a filter can feed its latest estimate before every
+ * step at the cost of two vector copies.
+ */
+class ImuCalibration {
+ public:
+  //! Identity calibration: measurements are used as they are
+  ImuCalibration()
+      : gyro_correction_(Matrix3x3::Identity()),
+        accel_correction_(Matrix3x3::Identity()) {}
+
+  /**
+   * @param[in] gyro_scale_misalignment gyro M (scale factor and misalignment)
+   * @param[in] accel_scale_misalignment accelerometer M
+   * @param[in] bias initial biases
+   */
+  ImuCalibration(const Matrix3x3 &gyro_scale_misalignment,
+                 const Matrix3x3 &accel_scale_misalignment,
+                 const ImuBias &bias = ImuBias())
+      : bias_(bias),
+        gyro_correction_(
+            (Matrix3x3::Identity() + gyro_scale_misalignment).inverse()),
+        accel_correction_(
+            (Matrix3x3::Identity() + accel_scale_misalignment).inverse()) {}
+
+  //! Replace the bias estimate (time-varying bias)
+  void set_bias(const ImuBias &bias) noexcept { bias_ = bias; }
+  const ImuBias &bias() const noexcept { return bias_; }
+
+  //! (I + M_g)^-1
+  const Matrix3x3 &gyro_correction() const noexcept {
+    return gyro_correction_;
+  }
+  //! (I + M_a)^-1
+  const Matrix3x3 &accel_correction() const noexcept {
+    return accel_correction_;
+  }
+
+  //! Corrected angular rate
+  Vector3 angular_rate(const Vector3 &measured) const noexcept {
+    return gyro_correction_ * (measured - bias_.gyro);
+  }
+  //! Corrected specific force
+  Vector3 specific_force(const Vector3 &measured) const noexcept {
+    return accel_correction_ * (measured - bias_.accel);
+  }
+
+  //! Corrected sample, may be the same object as raw
+  void apply(const ImuSample &raw, ImuSample &corrected) const noexcept {
+    corrected.angular_rate = angular_rate(raw.angular_rate);
+    corrected.specific_force = specific_force(raw.specific_force);
+    corrected.time = raw.time;
+    corrected.dt = raw.dt;
+  }
+
+ private:
+  ImuBias bias_;
+  Matrix3x3 gyro_correction_;
+  Matrix3x3 accel_correction_;
+};
+
+namespace ecef {
+
+/**
+ * @brief Forward propagation of a state by one raw IMU sample, calibrated
+ * inline, real-time safe
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in] minus prior state
+ * @param[in] gravitation gravitation as 3-vector
+ * @param[in] raw uncorrected inertial measurement
+ * @param[in] calibration IMU error model, with the current bias estimate
+ * @param[out] plus propagated state, may be the same object as minus
+ *
+ * The corrected angular rate and specific force are formed on the stack just
+ * before the step, so a replay makes a single pass over the raw samples. The
+ * result is bitwise that of calibration.apply() followed by fwd_pva_S03_rt.
+ */
+template <class GeodeMdl>
+void fwd_pva_S03_rt(const StatePvaSO3 &minus, const Vector3 &gravitation,
+                    const ImuSample &raw, const ImuCalibration &calibration,
+                    StatePvaSO3 &plus) noexcept {
+  const Vector3 angular_rate = calibration.angular_rate(raw.angular_rate);
+  const Vector3 specific_force =
+      calibration.specific_force(raw.specific_force);
+  fwd_pva_S03_rt<GeodeMdl>(minus.position, minus.velocity, minus.attitude,
+                           gravitation, specific_force, angular_rate, raw.dt,
+                           plus.position, plus.velocity, plus.attitude);
+  plus.time = raw.time;
+}
+
+/**
+ * @brief Propagate a state over count raw samples, calibrated inline
+ *
+ * @tparam GeodeMdl geodetic model
+ * @param[in,out] state state, propagated in place
+ * @param[in] raw uncorrected inertial measurements
+ * @param[in] count number of samples
+ * @param[in] calibration IMU error model
+ *
+ * Gravitation is evaluated at the prior position of each step. The
+ * calibration is constant over the batch; to follow a time-varying bias,
+ * split the batch where the estimate changes and call set_bias() between
+ * calls.
+ */
+template <class GeodeMdl>
+void fwd_pva_S03_rt(StatePvaSO3 &state, const ImuSample *raw,
+                    std::size_t count,
+                    const ImuCalibration &calibration) noexcept {
+  // Hoisted: one copy of the parameters for the whole batch
+  const Matrix3x3 gyro_correction = calibration.gyro_correction();
+  const Matrix3x3 accel_correction = calibration.accel_correction();
+  const ImuBias bias = calibration.bias();
+  for (std::size_t i = 0; i < count; ++i) {
+    const Vector3 angular_rate =
+        gyro_correction * (raw[i].angular_rate - bias.gyro);
+    const Vector3 specific_force =
+        accel_correction * (raw[i].specific_force - bias.accel);
+    const Vector3 gravitation =
+        geodetic::gravitation_ecef<GeodeMdl>(state.position);
+    fwd_pva_S03_rt<GeodeMdl>(state.position, state.velocity, state.attitude,
+                             gravitation, specific_force, angular_rate,
+                             raw[i].dt, state.position, state.velocity,
+                             state.attitude);
+    state.time = raw[i].time;
+  }
+}
+
+#ifdef ENNUI_CORE
+// Precompiled in Ennui::core
+extern template void fwd_pva_S03_rt<geodetic::Wgs84>(
+    const StatePvaSO3 &minus, const Vector3 &gravitation,
+    const ImuSample &raw, const ImuCalibration &calibration,
+    StatePvaSO3 &plus) noexcept;
+extern template void fwd_pva_S03_rt<geodetic::Wgs84>(
+    StatePvaSO3 &state, const ImuSample *raw, std::size_t count,
+    const ImuCalibration &calibration) noexcept;
+#endif
+
+}  // namespace ecef
+}  // namespace mechanization
+}  // namespace ennui
@@ -0,0 +1,267 @@
+/**
+ * @file preintegration.hpp
+ * @brief IMU preintegration with bias Jacobians and covariance
+ */
+
+#pragma once
+#include <math.h>
+
+#include <cstddef>
+
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+#include "rotation.hpp"
+
+namespace ennui {
+namespace mechanization {
+namespace ecef {
+
+//! White-noise densities of the inertial sensors
+struct ImuNoise {
+  //! Angle random walk [rad/sqrt(s)]
+  double gyro_noise_density = 0.0;
+  //! Velocity random walk [m/s/sqrt(s)]
+  double accel_noise_density = 0.0;
+};
+
+/**
+ * @brief Summary of an IMU segment, independent of the state at its start
+ *
+ * Integrates bias-corrected samples (measurement minus bias) into the body
+ * frame at the start of the segment, i:
+ *
+ *   delta_rotation  dR = C^i_j
+ *   delta_velocity  dv = sum of C^i_k Rb_mean f dt
+ *   delta_position  dp = double integral of the same specific force
+ *
+ * with the constant-rate and mean-rotation models of fwd_pva_S03. Gravitation
+ * and Earth rotation are applied only in predict(), so a segment is integrated
+ * once and reused for any start state.
+ *
+ * The segment is integrated at a bias estimate. First-order Jacobians of the
+ * deltas with respect to the gyro and accelerometer biases let corrected()
+ * and predict() account for a new bias estimate without re-integration. The
+ * covariance of the error [dphi, dv, dp] (rotation error on the right of dR)
+ * is propagated from the sensor noise densities; bias random walk between
+ * segments is left to the caller.
+ *
+ * See \cite forster_manifold_2017 for the preintegration recursions.
+ */
+class ImuPreintegration {
+ public:
+  ImuPreintegration(const Vector3 &bias_gyro = Vector3::Zero(),
+                    const Vector3 &bias_accel = Vector3::Zero(),
+                    const ImuNoise &noise = ImuNoise())
+      : noise_(noise) {
+    reset(bias_gyro, bias_accel);
+  }
+
+  //! Start a new segment, integrated at the given bias estimate
+  void reset(const Vector3 &bias_gyro, const Vector3 &bias_accel) {
+    bias_gyro_ = bias_gyro;
+    bias_accel_ = bias_accel;
+    duration_ = 0.0;
+    samples_ = 0;
+    delta_rotation_.setIdentity();
+    delta_velocity_.setZero();
+    delta_position_.setZero();
+    covariance_.setZero();
+    d_rotation_d_bias_gyro_.setZero();
+    d_velocity_d_bias_gyro_.setZero();
+    d_velocity_d_bias_accel_.setZero();
+    d_position_d_bias_gyro_.setZero();
+    d_position_d_bias_accel_.setZero();
+  }
+
+  //! Add one IMU sample to the segment
+  void integrate(const ImuSample &sample) {
+    const double dt = sample.dt;
+    const Vector3 f = sample.specific_force - bias_accel_;
+    const Vector3 alpha = (sample.angular_rate - bias_gyro_) * dt;
+    const double alpha_norm = alpha.stableNorm();
+    const Matrix3x3 alpha_cross = math::R3_to_so3(alpha);
+
+    // Mean body rotation over the sample (as in fwd_pva_S03), and the right
+    // Jacobian of SO(3), which is the same series evaluated at -alpha
+    Matrix3x3 Rb_mean, Jr;
+    if (alpha_norm > 1e-10) {
+      Rb_mean = math::mean_attitude_update(alpha_cross, alpha_norm);
+      Jr = math::mean_attitude_update(-alpha_cross, alpha_norm);
+    } else {
+      Rb_mean = math::mean_attitude_update_approx(alpha_cross, alpha_norm);
+      Jr = math::mean_attitude_update_approx(-alpha_cross, alpha_norm);
+    }
+    const Matrix3x3 Rb_prop = math::R3_to_SO3(alpha);
+
+    const Matrix3x3 R = delta_rotation_;
+    const Matrix3x3 RM = R * Rb_mean;
+    const Vector3 dv = RM * f * dt;
+    const Matrix3x3 R_f_cross = RM * math::R3_to_so3(f);
+
+    // Error-state transition and noise input, [dphi, dv, dp]
+    Matrix9x9 A = Matrix9x9::Identity();
+    A.block<3, 3>(0, 0) = Rb_prop.transpose();
+    A.block<3, 3>(3, 0) = -R_f_cross * dt;
+    A.block<3, 3>(6, 0) = -0.5 * R_f_cross * dt * dt;
+    A.block<3, 3>(6, 3) = Matrix3x3::Identity() * dt;
+    const double qg = noise_.gyro_noise_density * noise_.gyro_noise_density;
+    const double qa = noise_.accel_noise_density * noise_.accel_noise_density;
+    Matrix9x9 Q = Matrix9x9::Zero();
+    Q.block<3, 3>(0, 0) = qg * dt * Jr * Jr.transpose();
+    Q.block<3, 3>(3, 3) = qa * dt * RM * RM.transpose();
+    Q.block<3, 3>(3, 6) = 0.5 * qa * dt * dt * RM * RM.transpose();
+    Q.block<3, 3>(6, 3) = Q.block<3, 3>(3, 6);
+    Q.block<3, 3>(6, 6) = 0.25 * qa * dt * dt * dt * RM * RM.transpose();
+    covariance_ = A * covariance_ * A.transpose() + Q;
+
+    // Bias Jacobians: position first, it uses the prior velocity Jacobians
+    d_position_d_bias_accel_ +=
+        d_velocity_d_bias_accel_ * dt - 0.5 * RM * dt * dt;
+    d_position_d_bias_gyro_ += d_velocity_d_bias_gyro_ * dt -
+                               0.5 * R_f_cross * d_rotation_d_bias_gyro_ * dt *
+                                   dt;
+    d_velocity_d_bias_accel_ -= RM * dt;
+    d_velocity_d_bias_gyro_ -= R_f_cross * d_rotation_d_bias_gyro_ * dt;
+    d_rotation_d_bias_gyro_ =
+        Rb_prop.transpose() * d_rotation_d_bias_gyro_ - Jr * dt;
+
+    // Deltas
+    delta_position_ += delta_velocity_ * dt + 0.5 * dv * dt;
+    delta_velocity_ += dv;
+    delta_rotation_ = math::normalize_SO3_Groves(R * Rb_prop);
+    duration_ += dt;
+    ++samples_;
+  }
+
+  /**
+   * @brief Deltas at a new bias estimate, to first order
+   *
+   * @param[in] bias_gyro gyro bias estimate
+   * @param[in] bias_accel accelerometer bias estimate
+   * @param[out] delta_rotation corrected C^i_j
+   * @param[out] delta_velocity corrected velocity delta
+   * @param[out] delta_position corrected position delta
+   */
+  void corrected(const Vector3 &bias_gyro, const Vector3 &bias_accel,
+                 Matrix3x3 &delta_rotation, Vector3 &delta_velocity,
+                 Vector3 &delta_position) const {
+    const Vector3 dbg = bias_gyro - bias_gyro_;
+    const Vector3 dba = bias_accel - bias_accel_;
+    delta_rotation = math::normalize_SO3_Groves(
+        delta_rotation_ * math::R3_to_SO3(d_rotation_d_bias_gyro_ * dbg));
+    delta_velocity = delta_velocity_ + d_velocity_d_bias_gyro_ * dbg +
+                     d_velocity_d_bias_accel_ * dba;
+    delta_position = delta_position_ + d_position_d_bias_gyro_ * dbg +
+                     d_position_d_bias_accel_ * dba;
+  }
+
+  /**
+   * @brief Propagate an ECEF state across the segment
+   *
+   * @tparam GeodeMdl geodetic model
+   * @param[in] minus state at the start of the segment
+   * @param[in] bias_gyro gyro bias estimate
+   * @param[in] bias_accel accelerometer bias estimate
+   * @param[out] plus state at the end of the segment, may alias minus
+   *
+   * The deltas are applied in the inertial frame aligned with ECEF at the
+   * start of the segment and the result is rotated back by the Earth rotation
+   * over the segment, which yields the Coriolis and centripetal terms of
+   * fwd_pva_S03. Gravitation (gravitation_ecef, fixed in ECEF) is averaged
+   * between the start and a predicted end position.
+   */
+  template <class GeodeMdl>
+  void predict(const StatePvaSO3 &minus, const Vector3 &bias_gyro,
+               const Vector3 &bias_accel, StatePvaSO3 &plus) const {
+    Matrix3x3 dR;
+    Vector3 dv, dp;
+    corrected(bias_gyro, bias_accel, dR, dv, dp);
+
+    const double T = duration_;
+    const Matrix3x3 Omega =
+        math::R3_to_so3({0, 0, GeodeMdl::EARTH_ROTATION_RATE});
+    const Matrix3x3 Omega2 = Omega * Omega;
+    // Single and double integrals of exp(Omega t) over [0, T]; the series is
+    // exact to double precision while |Omega| T << 1
+    const Matrix3x3 S1 = T * Matrix3x3::Identity() + T * T / 2 * Omega +
+                         T * T * T / 6 * Omega2;
+    const Matrix3x3 S2 = T * T / 2 * Matrix3x3::Identity() +
+                         T * T * T / 6 * Omega +
+                         T * T * T * T / 24 * Omega2;
+    const Matrix3x3 E =
+        math::R3_to_SO3(Vector3{0, 0, -GeodeMdl::EARTH_ROTATION_RATE * T});
+
+    const Vector3 inertial_velocity = minus.velocity + Omega * minus.position;
+    const Vector3 dv_e = minus.attitude * dv;
+    const Vector3 dp_e =
+        minus.position + T * inertial_velocity + minus.attitude * dp;
+
+    const Vector3 gravitation_minus =
+        geodetic::gravitation_ecef<GeodeMdl>(minus.position);
+    const Vector3 position_guess = E * (dp_e + S2 * gravitation_minus);
+    const Vector3 gravitation =
+        0.5 * (gravitation_minus +
+               geodetic::gravitation_ecef<GeodeMdl>(position_guess));
+
+    const Vector3 position = E * (dp_e + S2 * gravitation);
+    plus.velocity =
+        E * (inertial_velocity + dv_e + S1 * gravitation) - Omega * position;
+    plus.attitude = math::normalize_SO3_Groves(E * minus.attitude * dR);
+    plus.position = position;
+    plus.time = minus.time + T;
+  }
+
+  //! Gyro bias the segment was integrated at
+  const Vector3 &bias_gyro() const { return bias_gyro_; }
+  //! Accelerometer bias the segment was integrated at
+  const Vector3 &bias_accel() const { return bias_accel_; }
+  //! Sum of sample intervals [s]
+  double duration() const { return duration_; }
+  //! Number of samples integrated
+  std::size_t samples() const { return samples_; }
+
+  //! Rotation from the body frame at the end to the start of the segment
+  const Matrix3x3 &delta_rotation() const { return delta_rotation_; }
+  //! Velocity change from specific force, start body frame
+  const Vector3 &delta_velocity() const { return delta_velocity_; }
+  //! Position change from specific force, start body frame
+  const Vector3 &delta_position() const { return delta_position_; }
+  //! Covariance of the error in [rotation, velocity, position] deltas
+  const Matrix9x9 &covariance() const { return covariance_; }
+
+  const Matrix3x3 &d_rotation_d_bias_gyro() const {
+    return d_rotation_d_bias_gyro_;
+  }
+  const Matrix3x3 &d_velocity_d_bias_gyro() const {
+    return d_velocity_d_bias_gyro_;
+  }
+  const Matrix3x3 &d_velocity_d_bias_accel() const {
+    return d_velocity_d_bias_accel_;
+  }
+  const Matrix3x3 &d_position_d_bias_gyro() const {
+    return d_position_d_bias_gyro_;
+  }
+  const Matrix3x3 &d_position_d_bias_accel() const {
+    return d_position_d_bias_accel_;
+  }
+
+ private:
+  ImuNoise noise_;
+  Vector3 bias_gyro_;
+  Vector3 bias_accel_;
+  double duration_;
+  std::size_t samples_;
+  Matrix3x3 delta_rotation_;
+  Vector3 delta_velocity_;
+  Vector3 delta_position_;
+  Matrix9x9 covariance_;
+  Matrix3x3 d_rotation_d_bias_gyro_;
+  Matrix3x3 d_velocity_d_bias_gyro_;
+  Matrix3x3 d_velocity_d_bias_accel_;
+  Matrix3x3 d_position_d_bias_gyro_;
+  Matrix3x3 d_position_d_bias_accel_;
+};
+
+}  // namespace ecef
+}  // namespace mechanization
+}  // namespace ennui
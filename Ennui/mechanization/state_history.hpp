@@ -0,0 +1,224 @@
+/**
+ * @file state_history.hpp
+ * @brief Bounded history of propagated states with time queries
+ */
+
+#pragma once
+#include <math.h>
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "ennui_types.hpp"
+#include "rotation.hpp"
+
+namespace ennui {
+namespace mechanization {
+namespace ecef {
+
+/**
+ * @brief Recent ECEF states and IMU increments, queryable at any time
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * Retains up to a fixed number of propagated states (and the angular rate of
+ * the IMU sample that produced each) in a ring buffer allocated once at
+ * construction. States between two retained epochs are interpolated with the
+ * same constant-rate model fwd_pva_S03 integrates, without re-running the
+ * propagator:
+ *
+ * - attitude: the retained angular rate applied over the fraction of the
+ *   interval, with the Earth-rate correction and normalization of Eq. (5.75)
+ *   \cite groves_principles_2013, i.e. it stays on SO(3) and reproduces the
+ *   retained attitudes exactly at the epochs,
+ * - velocity: linear (constant acceleration across the interval),
+ * - position: the matching quadratic, whose derivative is the velocity.
+ *
+ * Position and velocity reproduce the retained states at the epochs. Between
+ * them they differ from re-propagating with a fractional time step only by the
+ * change of the mean specific-force rotation over the interval.
+ */
+template <class GeodeMdl>
+class StateHistory {
+ public:
+  //! Node of the history: state and angular rate of the interval ending there
+  struct Epoch {
+    StatePvaSO3 state;
+    Vector3 angular_rate;
+  };
+
+  //! Allocate storage for capacity states (at least 2)
+  explicit StateHistory(std::size_t capacity)
+      : epochs_(capacity < 2 ? 2 : capacity), first_(0), size_(0) {}
+
+  //! Discard the history and start from an initial state
+  void reset(const StatePvaSO3 &initial) {
+    first_ = 0;
+    size_ = 1;
+    epochs_[0] = Epoch{initial, Vector3::Zero()};
+  }
+
+  /**
+   * @brief Append the state propagated by one IMU sample
+   *
+   * @param[in] state propagated state, state.time must exceed newest_time()
+   * @param[in] sample IMU sample that produced the state
+   *
+   * The oldest state is discarded once the capacity is reached.
+   */
+  void push(const StatePvaSO3 &state, const ImuSample &sample) {
+    const Epoch epoch{state, sample.angular_rate};
+    if (size_ < epochs_.size()) {
+      epochs_[index(size_)] = epoch;
+      ++size_;
+    } else {
+      epochs_[first_] = epoch;
+      first_ = index(1);
+    }
+  }
+
+  //! Number of retained states
+  std::size_t size() const { return size_; }
+
+  //! Maximum number of retained states
+  std::size_t capacity() const { return epochs_.size(); }
+
+  //! Time of the oldest retained state
+  double oldest_time() const { return at_index(0).state.time; }
+
+  //! Time of the newest retained state
+  double newest_time() const { return at_index(size_ - 1).state.time; }
+
+  //! Retained epoch, 0 being the oldest
+  const Epoch &at_index(std::size_t i) const { return epochs_[index(i)]; }
+
+  /**
+   * @brief State at an arbitrary time
+   *
+   * @param[in] time query time within [oldest_time(), newest_time()]
+   * @param[out] state interpolated state
+   * @return false (and state is unchanged) if time is out of range
+   *
+   * The newest interval is tried first, then a binary search over the
+   * retained epochs: O(log size()).
+   */
+  bool at(double time, StatePvaSO3 &state) const {
+    std::size_t hint = size_ - 1;
+    return search_and_interpolate(time, hint, state);
+  }
+
+  /**
+   * @brief States at a batch of times
+   *
+   * @param[in] times count query times, in any order
+   * @param[in] count number of queries
+   * @param[out] states count interpolated states; queries out of range yield
+   * NaN position, velocity and attitude
+   * @return number of queries within range
+   *
+   * A query within two intervals after the previous one is found in constant
+   * time, so dense time-sorted batches cost O(count); any other query costs a
+   * binary search, O(log size()).
+   */
+  std::size_t at(const double *times, std::size_t count,
+                 StatePvaSO3 *states) const {
+    std::size_t found = 0;
+    std::size_t hint = 1;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (search_and_interpolate(times[i], hint, states[i])) {
+        ++found;
+      } else {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        states[i].time = times[i];
+        states[i].position.setConstant(nan);
+        states[i].velocity.setConstant(nan);
+        states[i].attitude.setConstant(nan);
+      }
+    }
+    return found;
+  }
+
+ private:
+  std::size_t index(std::size_t i) const {
+    const std::size_t j = first_ + i;
+    return j < epochs_.size() ? j : j - epochs_.size();
+  }
+
+  // Interpolate within the interval ending at the first epoch at or after
+  // time. The interval ending at `hint` and the two following it are tried
+  // before a binary search; hint is updated to the interval found.
+  bool search_and_interpolate(double time, std::size_t &hint,
+                              StatePvaSO3 &state) const {
+    if (size_ == 0 || time < oldest_time() || time > newest_time()) {
+      return false;
+    }
+    if (size_ == 1) {
+      state = at_index(0).state;
+      return true;
+    }
+    if (hint < 1 || hint >= size_) hint = size_ - 1;
+    std::size_t found = 0;
+    if (time >= at_index(hint - 1).state.time) {
+      const std::size_t last = hint + 2 < size_ ? hint + 2 : size_ - 1;
+      for (std::size_t i = hint; i <= last; ++i) {
+        if (at_index(i).state.time >= time) {
+          found = i;
+          break;
+        }
+      }
+    }
+    if (found == 0) {
+      std::size_t lo = 1, hi = size_ - 1;
+      while (lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (at_index(mid).state.time < time) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      found = lo;
+    }
+    hint = found;
+    interpolate(at_index(hint - 1), at_index(hint), time, state);
+    return true;
+  }
+
+  static void interpolate(const Epoch &e0, const Epoch &e1, double time,
+                          StatePvaSO3 &state) {
+    const StatePvaSO3 &s0 = e0.state;
+    const StatePvaSO3 &s1 = e1.state;
+    const double dt = s1.time - s0.time;
+    const double tau = time - s0.time;
+    if (tau <= 0) {
+      state = s0;
+      return;
+    }
+    if (tau >= dt) {
+      state = s1;
+      return;
+    }
+
+    // Attitude: Eq. (5.75) \cite groves_principles_2013 over tau
+    const Matrix3x3 Omega =
+        math::R3_to_so3({0, 0, GeodeMdl::EARTH_ROTATION_RATE});
+    const Matrix3x3 Rb_prop = math::R3_to_SO3(e1.angular_rate * tau);
+    state.attitude = math::normalize_SO3_Groves(s0.attitude * Rb_prop -
+                                                tau * Omega * s0.attitude);
+
+    // Constant acceleration over the interval, see Eq. (5.38)
+    const Vector3 accel = (s1.velocity - s0.velocity) / dt;
+    state.velocity = s0.velocity + accel * tau;
+    state.position = s0.position + tau * (s0.velocity + 0.5 * tau * accel);
+    state.time = time;
+  }
+
+  std::vector<Epoch> epochs_;
+  std::size_t first_;
+  std::size_t size_;
+};
+
+}  // namespace ecef
+}  // namespace mechanization
+}  // namespace ennui
@@ -0,0 +1,281 @@
+/**
+ * @file pipeline.hpp
+ * @brief Typed streaming pipeline of fixed-size blocks over bounded channels
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ennui {
+namespace pipeline {
+
+/**
+ * @brief Fixed-size block of items passed between stages
+ *
+ * @tparam T item type
+ * @tparam N capacity in items
+ *
+ * Blocks are allocated once, by the Channel that owns them, and are passed by
+ * reference; stages never copy or allocate blocks. The last block of a stream
+ * has last set (and may be partially filled, or empty).
+ */
+template <class T, std::size_t N = 256>
+struct Block {
+  typedef T value_type;
+  static constexpr std::size_t CAPACITY = N;
+
+  std::size_t size = 0;
+  bool last = false;
+  T items[N];
+
+  T &operator[](std::size_t i) { return items[i]; }
+  const T &operator[](std::size_t i) const { return items[i]; }
+};
+
+/**
+ * @brief Bounded hand-off of blocks between two stages
+ *
+ * @tparam B block type
+ *
+ * Owns a fixed pool of blocks. The producing stage acquire()s an empty block,
+ * fills it and push()es it; the consuming stage pop()s it and release()s it
+ * back to the pool once done. When all blocks are in flight acquire() waits:
+ * this is the backpressure that bounds memory and keeps a fast producer from
+ * running ahead of a slow consumer.
+ */
+template <class B>
+class Channel {
+ public:
+  explicit Channel(std::size_t blocks = 4)
+      : storage_(new B[blocks]), free_(blocks), full_(blocks) {
+    for (std::size_t i = 0; i < blocks; ++i) free_.put(&storage_[i]);
+  }
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  //! Producer: take an empty block, waiting if all are in flight
+  B *acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [this]() { return free_.count > 0; });
+    B *block = free_.take();
+    block->size = 0;
+    block->last = false;
+    return block;
+  }
+
+  //! Producer: hand a filled block to the consumer
+  void push(B *block) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      full_.put(block);
+    }
+    pushed_.notify_one();
+  }
+
+  //! Consumer: take the next filled block, waiting if none is ready
+  B *pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pushed_.wait(lock, [this]() { return full_.count > 0; });
+    return full_.take();
+  }
+
+  //! Consumer: return a block to the pool
+  void release(B *block) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_.put(block);
+    }
+    released_.notify_one();
+  }
+
+ private:
+  //! Fixed-capacity FIFO of block pointers
+  struct Fifo {
+    explicit Fifo(std::size_t capacity)
+        : slots(capacity), head(0), count(0) {}
+    void put(B *block) {
+      slots[(head + count++) % slots.size()] = block;
+    }
+    B *take() {
+      B *block = slots[head];
+      head = (head + 1) % slots.size();
+      --count;
+      return block;
+    }
+    std::vector<B *> slots;
+    std::size_t head;
+    std::size_t count;
+  };
+
+  std::unique_ptr<B[]> storage_;
+  std::mutex mutex_;
+  std::condition_variable released_;
+  std::condition_variable pushed_;
+  Fifo free_;
+  Fifo full_;
+};
+
+/**
+ * @brief Drive a source into a channel until it is exhausted
+ *
+ * A source is callable as bool(B &block): it fills block (setting size) and
+ * returns false once the stream has ended.
+ */
+template <class Source, class B>
+void run_source(Source &source, Channel<B> &out) {
+  for (;;) {
+    B *block = out.acquire();
+    block->last = !source(*block);
+    const bool last = block->last;
+    out.push(block);
+    if (last) return;
+  }
+}
+
+/**
+ * @brief Drive a stage from one channel to the next until the last block
+ *
+ * A stage is callable as void(const BIn &in, BOut &out) and sets out.size.
+ */
+template <class Stage, class BIn, class BOut>
+void run_stage(Stage &stage, Channel<BIn> &in, Channel<BOut> &out) {
+  for (;;) {
+    BIn *a = in.pop();
+    BOut *b = out.acquire();
+    stage(*a, *b);
+    b->last = a->last;
+    in.release(a);
+    out.push(b);
+    if (b->last) return;
+  }
+}
+
+/**
+ * @brief Drive a sink from a channel until the last block
+ *
+ * A sink is callable as void(const B &block).
+ */
+template <class Sink, class B>
+void run_sink(Sink &sink, Channel<B> &in) {
+  for (;;) {
+    B *block = in.pop();
+    sink(*block);
+    const bool last = block->last;
+    in.release(block);
+    if (last) return;
+  }
+}
+
+/**
+ * @brief Two stages fused into one, run on the same thread
+ *
+ * The intermediate block is owned by the fused stage, so nothing crosses a
+ * channel. Use to keep cheap stages together and give expensive ones their
+ * own thread.
+ */
+template <class First, class Second, class BMid>
+class Chain {
+ public:
+  Chain(First &first, Second &second)
+      : first_(first), second_(second), mid_(new BMid) {}
+
+  template <class BIn, class BOut>
+  void operator()(const BIn &in, BOut &out) {
+    mid_->size = 0;
+    mid_->last = in.last;
+    first_(in, *mid_);
+    second_(*mid_, out);
+  }
+
+ private:
+  First &first_;
+  Second &second_;
+  std::unique_ptr<BMid> mid_;
+};
+
+//! Fuse two stages through an intermediate block type
+template <class BMid, class First, class Second>
+Chain<First, Second, BMid> chain(First &first, Second &second) {
+  return Chain<First, Second, BMid>(first, second);
+}
+
+/**
+ * @brief Run source, stage and sink on the calling thread
+ *
+ * The serial counterpart of a threaded Pipeline, with one block per edge.
+ */
+template <class BIn, class BOut, class Source, class Stage, class Sink>
+void run_serial(Source &source, Stage &stage, Sink &sink) {
+  std::unique_ptr<BIn> in(new BIn);
+  std::unique_ptr<BOut> out(new BOut);
+  bool more = true;
+  while (more) {
+    in->size = 0;
+    more = source(*in);
+    in->last = !more;
+    out->size = 0;
+    stage(*in, *out);
+    out->last = in->last;
+    sink(*out);
+  }
+}
+
+/**
+ * @brief Threads and channels of a running pipeline
+ *
+ * Each source, stage and sink added runs on its own thread until the last
+ * block has passed through it; join() waits for all of them. Channels are
+ * created by (and live as long as) the pipeline. Stages, sources and sinks
+ * are held by reference, so results can be read from them after join().
+ * They must not throw.
+ */
+class Pipeline {
+ public:
+  Pipeline() = default;
+  Pipeline(const Pipeline &) = delete;
+  Pipeline &operator=(const Pipeline &) = delete;
+  ~Pipeline() { join(); }
+
+  //! Create a channel of the given number of blocks
+  template <class B>
+  Channel<B> &channel(std::size_t blocks = 4) {
+    std::shared_ptr<Channel<B>> c(new Channel<B>(blocks));
+    channels_.push_back(c);
+    return *c;
+  }
+
+  template <class Source, class B>
+  void source(Source &source, Channel<B> &out) {
+    threads_.emplace_back([&source, &out]() { run_source(source, out); });
+  }
+
+  template <class Stage, class BIn, class BOut>
+  void stage(Stage &stage, Channel<BIn> &in, Channel<BOut> &out) {
+    threads_.emplace_back(
+        [&stage, &in, &out]() { run_stage(stage, in, out); });
+  }
+
+  template <class Sink, class B>
+  void sink(Sink &sink, Channel<B> &in) {
+    threads_.emplace_back([&sink, &in]() { run_sink(sink, in); });
+  }
+
+  //! Wait until the stream has drained through every thread
+  void join() {
+    for (std::thread &t : threads_) t.join();
+    threads_.clear();
+  }
+
+ private:
+  std::vector<std::shared_ptr<void>> channels_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace pipeline
+}  // namespace ennui
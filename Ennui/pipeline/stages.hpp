@@ -0,0 +1,170 @@
+/**
+ * @file stages.hpp
+ * @brief Ready-made pipeline stages around mechanization and geodetic models
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "frame_transform.hpp"
+#include "gravitation.hpp"
+#include "imu_calibration.hpp"
+#include "local_frame.hpp"
+#include "pipeline.hpp"
+
+namespace ennui {
+namespace pipeline {
+
+//! Block of IMU samples
+template <std::size_t N = 256>
+using ImuBlock = Block<ImuSample, N>;
+
+//! Block of propagated states
+template <std::size_t N = 256>
+using StateBlock = Block<StatePvaSO3, N>;
+
+//! Block of 3-vectors (positions, gravitation, ...)
+template <std::size_t N = 256>
+using Vector3Block = Block<Vector3, N>;
+
+/**
+ * @brief Geodetic (lat [deg], lon [deg], h [m]) to ECEF positions
+ *
+ * @tparam GeodeMdl geodetic model
+ */
+template <class GeodeMdl>
+struct GeodeticToEcef {
+  template <std::size_t N>
+  void operator()(const Vector3Block<N> &llh, Vector3Block<N> &ecef) const {
+    for (std::size_t i = 0; i < llh.size; ++i) {
+      ecef[i] = geodetic::position_geodetic_to_ecef<GeodeMdl>(llh[i]);
+    }
+    ecef.size = llh.size;
+  }
+};
+
+/**
+ * @brief ECEF positions to gravitation
+ *
+ * @tparam GeodeMdl geodetic model
+ */
+template <class GeodeMdl>
+struct Gravitation {
+  template <std::size_t N>
+  void operator()(const Vector3Block<N> &positions,
+                  Vector3Block<N> &gravitation) const {
+    for (std::size_t i = 0; i < positions.size; ++i) {
+      gravitation[i] = geodetic::gravitation_ecef<GeodeMdl>(positions[i]);
+    }
+    gravitation.size = positions.size;
+  }
+};
+
+/**
+ * @brief ECEF mechanization: IMU samples to the state after each sample
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * Holds the running state across blocks. Gravitation is evaluated at the
+ * prior position of each step, as in realtime::ImuIngest, so a stream yields
+ * bitwise the same states as a serial loop over fwd_pva_S03_rt.
+ */
+template <class GeodeMdl>
+class Mechanize {
+ public:
+  explicit Mechanize(const StatePvaSO3 &initial) : state_(initial) {}
+
+  template <std::size_t N>
+  void operator()(const ImuBlock<N> &samples, StateBlock<N> &states) {
+    for (std::size_t i = 0; i < samples.size; ++i) {
+      const Vector3 gravitation =
+          geodetic::gravitation_ecef<GeodeMdl>(state_.position);
+      mechanization::ecef::fwd_pva_S03_rt<GeodeMdl>(state_, gravitation,
+                                                    samples[i], state_);
+      states[i] = state_;
+    }
+    states.size = samples.size;
+  }
+
+  //! Most recent state (read after the stream has drained)
+  const StatePvaSO3 &state() const { return state_; }
+
+ private:
+  StatePvaSO3 state_;
+};
+
+/**
+ * @brief ECEF mechanization of raw IMU samples, calibrated inline
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * As Mechanize, with each sample corrected by an ImuCalibration inside the
+ * step rather than in a separate stage. set_bias() may be called between
+ * blocks from the thread running the stage.
+ */
+template <class GeodeMdl>
+class CalibratedMechanize {
+ public:
+  CalibratedMechanize(const StatePvaSO3 &initial,
+                      const mechanization::ImuCalibration &calibration)
+      : state_(initial), calibration_(calibration) {}
+
+  template <std::size_t N>
+  void operator()(const ImuBlock<N> &samples, StateBlock<N> &states) {
+    for (std::size_t i = 0; i < samples.size; ++i) {
+      const Vector3 gravitation =
+          geodetic::gravitation_ecef<GeodeMdl>(state_.position);
+      mechanization::ecef::fwd_pva_S03_rt<GeodeMdl>(
+          state_, gravitation, samples[i], calibration_, state_);
+      states[i] = state_;
+    }
+    states.size = samples.size;
+  }
+
+  void set_bias(const mechanization::ImuBias &bias) {
+    calibration_.set_bias(bias);
+  }
+
+  const StatePvaSO3 &state() const { return state_; }
+
+ private:
+  StatePvaSO3 state_;
+  mechanization::ImuCalibration calibration_;
+};
+
+/**
+ * @brief ECEF states resolved in a local tangent-plane frame
+ *
+ * @tparam GeodeMdl geodetic model
+ *
+ * Position, velocity and attitude are converted with geodetic::LocalFrame;
+ * time is passed through.
+ */
+template <class GeodeMdl>
+class ToLocalFrame {
+ public:
+  explicit ToLocalFrame(const geodetic::LocalFrame<GeodeMdl> &frame)
+      : frame_(frame) {}
+
+  template <std::size_t N>
+  void operator()(const StateBlock<N> &ecef, StateBlock<N> &local) const {
+    for (std::size_t i = 0; i < ecef.size; ++i) {
+      local[i].time = ecef[i].time;
+      local[i].position = frame_.position_from_ecef(ecef[i].position);
+      local[i].velocity = frame_.velocity_from_ecef(ecef[i].velocity);
+      local[i].attitude = frame_.attitude_from_ecef(ecef[i].attitude);
+    }
+    local.size = ecef.size;
+  }
+
+  const geodetic::LocalFrame<GeodeMdl> &frame() const { return frame_; }
+
+ private:
+  geodetic::LocalFrame<GeodeMdl> frame_;
+};
+
+}  // namespace pipeline
+}  // namespace ennui
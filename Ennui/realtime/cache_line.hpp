@@ -0,0 +1,79 @@
+/**
+ * @file cache_line.hpp
+ * @brief Cache-line size used to pad data shared between threads
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace ennui {
+namespace realtime {
+
+/**
+ * @brief Assumed size of a cache line in bytes
+ *
+ * Members written by different threads are aligned to this boundary to avoid
+ * false sharing. 64 bytes matches current x86-64 and most ARMv8 parts.
+ */
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+//! Allocate size bytes on a cache-line boundary, throws std::bad_alloc
+inline void *cache_aligned_malloc(std::size_t size) {
+  if (size == 0) size = 1;
+#if defined(_WIN32)
+  void *ptr = _aligned_malloc(size, CACHE_LINE_SIZE);
+#else
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, CACHE_LINE_SIZE, size) != 0) ptr = nullptr;
+#endif
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+//! Release memory obtained from cache_aligned_malloc
+inline void cache_aligned_free(void *ptr) noexcept {
+#if defined(_WIN32)
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+}  // namespace realtime
+}  // namespace ennui
+
+/**
+ * @brief Class-level operator new/delete honouring CACHE_LINE_SIZE alignment
+ *
+ * Before C++17 a plain new-expression only guarantees alignof(std::max_align_t)
+ * even for alignas(CACHE_LINE_SIZE) types, which would put the padded members
+ * of a heap-allocated object on shared cache lines. Place this macro in the
+ * public section of every such class that may be created with new, in the
+ * spirit of EIGEN_MAKE_ALIGNED_OPERATOR_NEW.
+ */
+#define ENNUI_CACHE_ALIGNED_OPERATOR_NEW                                   \
+  static void *operator new(std::size_t size) {                            \
+    return ::ennui::realtime::cache_aligned_malloc(size);                  \
+  }                                                                        \
+  static void *operator new[](std::size_t size) {                          \
+    return ::ennui::realtime::cache_aligned_malloc(size);                  \
+  }                                                                        \
+  static void *operator new(std::size_t, void *ptr) noexcept { return ptr; } \
+  static void *operator new[](std::size_t, void *ptr) noexcept {           \
+    return ptr;                                                            \
+  }                                                                        \
+  static void operator delete(void *ptr) noexcept {                        \
+    ::ennui::realtime::cache_aligned_free(ptr);                            \
+  }                                                                        \
+  static void operator delete[](void *ptr) noexcept {                      \
+    ::ennui::realtime::cache_aligned_free(ptr);                            \
+  }                                                                        \
+  static void operator delete(void *, void *) noexcept {}                  \
+  static void operator delete[](void *, void *) noexcept {}
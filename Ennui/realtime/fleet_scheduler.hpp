@@ -0,0 +1,339 @@
+/**
+ * @file fleet_scheduler.hpp
+ * @brief Propagation of many vehicles on a shared, core-pinned worker pool
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+#include "imu_ingest.hpp"
+#include "latency_histogram.hpp"
+#include "mpmc_queue.hpp"
+#include "seqlock.hpp"
+#include "spsc_ring.hpp"
+
+namespace ennui {
+namespace realtime {
+
+//! Worker pool settings of a FleetScheduler
+struct FleetConfig {
+  //! Worker threads started by start(); 0 to drive run_once() manually
+  std::size_t workers = 1;
+  //! Vehicles taken from the ready queue per batch
+  std::size_t batch_vehicles = 32;
+  //! Steps of one vehicle run per visit before it yields to the others
+  std::size_t max_steps_per_vehicle = 64;
+  //! Pin worker i to core (first_core + i) modulo the number of cores
+  bool pin_threads = true;
+  std::size_t first_core = 0;
+};
+
+//! Throughput and queueing latency of a FleetScheduler
+struct FleetReport {
+  //! IMU steps propagated
+  std::uint64_t steps = 0;
+  //! Batches taken from the ready queue
+  std::uint64_t batches = 0;
+  //! Packets rejected because a vehicle inbox was full
+  std::uint64_t dropped = 0;
+  //! Workers successfully pinned to a core
+  std::size_t pinned = 0;
+  //! Wall time between start() and stop() [s]
+  double seconds = 0.0;
+  //! Submit-to-publish latency of every step [ns]
+  LatencyHistogram latency;
+
+  double steps_per_second() const { return seconds > 0 ? steps / seconds : 0; }
+};
+
+/**
+ * @brief Propagates a fleet of vehicles from asynchronously arriving packets
+ *
+ * @tparam GeodeMdl geodetic model
+ * @tparam InboxCapacity packets buffered per vehicle, a power of two
+ *
+ * Vehicle states live in one contiguous, cache-line aligned pool. submit()
+ * appends a packet to the vehicle's SpscRing inbox and, if the vehicle is not
+ * already scheduled, puts its index on a shared MpmcQueue of ready vehicles.
+ * Workers take batches of ready vehicles, propagate each through its pending
+ * packets with the allocation-free fwd_pva_S03_rt, and publish the state
+ * through a per-vehicle SeqLock.
+ *
+ * A vehicle is on the ready queue at most once and owned by at most one
+ * worker at a time (its scheduled flag is the ownership token), so its
+ * packets are always applied in submission order. A vehicle with more than
+ * max_steps_per_vehicle packets pending goes back to the end of the queue,
+ * which keeps busy vehicles from starving the others.
+ *
+ * Packets of one vehicle must be submitted from one thread at a time (e.g.
+ * the thread serving its connection); different vehicles may be submitted
+ * from different threads.
+ */
+template <class GeodeMdl, std::size_t InboxCapacity = 64>
+class FleetScheduler {
+ public:
+  /**
+   * @param[in] initial initial state of each vehicle
+   * @param[in] config worker pool settings
+   * @throw std::invalid_argument if config.batch_vehicles or
+   * config.max_steps_per_vehicle is zero
+   */
+  FleetScheduler(const std::vector<StatePvaSO3> &initial,
+                 const FleetConfig &config = FleetConfig())
+      : config_(config),
+        vehicles_(initial.size()),
+        pool_(new Vehicle[initial.size()]),
+        ready_(initial.size()),
+        caller_(new Worker(config)),
+        stop_(false),
+        running_(false) {
+    // Either limit at zero would leave submitted packets unprocessed forever
+    if (config.batch_vehicles == 0 || config.max_steps_per_vehicle == 0) {
+      throw std::invalid_argument("invalid fleet configuration");
+    }
+    for (std::size_t i = 0; i < vehicles_; ++i) {
+      pool_[i].state = initial[i];
+      pool_[i].published.store(PublishedState{0, initial[i]});
+    }
+  }
+  FleetScheduler(const FleetScheduler &) = delete;
+  FleetScheduler &operator=(const FleetScheduler &) = delete;
+  ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+
+  ~FleetScheduler() { stop(); }
+
+  //! Number of vehicles in the pool
+  std::size_t vehicles() const noexcept { return vehicles_; }
+
+  /**
+   * @brief Producer: queue one IMU sample for a vehicle
+   *
+   * @param[in] vehicle index in the initial states, less than vehicles()
+   * @return false (and the packet is counted as dropped) if the vehicle's
+   * inbox is full
+   */
+  bool submit(std::size_t vehicle, const ImuSample &sample) noexcept {
+    assert(vehicle < vehicles_);
+    Vehicle &v = pool_[vehicle];
+    if (!v.inbox.try_push(Packet{sample, now_ns()})) {
+      v.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    // Pairs with the fence in service(): either the worker sees this packet
+    // or this thread sees the vehicle unscheduled
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    schedule(vehicle);
+    return true;
+  }
+
+  //! Any thread: most recently published state of a vehicle
+  PublishedState latest(std::size_t vehicle) const noexcept {
+    assert(vehicle < vehicles_);
+    return pool_[vehicle].published.load();
+  }
+
+  //! Launch config.workers worker threads
+  void start() {
+    if (running_) return;
+    stop_.store(false, std::memory_order_relaxed);
+    started_ = std::chrono::steady_clock::now();
+    // Counters carry over a stop()/start() cycle
+    while (workers_.size() < config_.workers) {
+      workers_.emplace_back(new Worker(config_));
+    }
+    for (std::size_t i = 0; i < config_.workers; ++i) {
+      threads_.emplace_back(&FleetScheduler::work, this, i);
+    }
+    running_ = true;
+  }
+
+  //! Stop and join the workers; packets still queued stay queued
+  void stop() {
+    if (!running_) return;
+    stop_.store(true, std::memory_order_release);
+    for (std::thread &t : threads_) t.join();
+    threads_.clear();
+    seconds_ += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - started_)
+                    .count();
+    running_ = false;
+  }
+
+  /**
+   * @brief Process one batch from the calling thread
+   *
+   * @return number of steps propagated
+   *
+   * For config.workers == 0, or to help the workers. Not to be called
+   * concurrently from several threads.
+   */
+  std::size_t run_once() { return run_batch(*caller_); }
+
+  /**
+   * @brief Counters and latency merged over all workers
+   *
+   * Call when no worker is running (after stop(), or with no workers).
+   */
+  FleetReport report() const {
+    FleetReport report;
+    report.seconds = seconds_;
+    merge(*caller_, report);
+    for (const std::unique_ptr<Worker> &w : workers_) merge(*w, report);
+    for (std::size_t i = 0; i < vehicles_; ++i) {
+      report.dropped += pool_[i].dropped.load(std::memory_order_relaxed);
+    }
+    return report;
+  }
+
+ private:
+  struct Packet {
+    ImuSample sample;
+    std::int64_t submitted_ns;
+  };
+
+  struct alignas(CACHE_LINE_SIZE) Vehicle {
+    Vehicle() : count(0), scheduled(false), dropped(0) {}
+    ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+    // Owned by the worker currently holding the vehicle
+    StatePvaSO3 state;
+    std::uint64_t count;
+    std::atomic<bool> scheduled;
+    std::atomic<std::uint64_t> dropped;
+    SpscRing<Packet, InboxCapacity> inbox;
+    SeqLock<PublishedState> published;
+  };
+
+  struct alignas(CACHE_LINE_SIZE) Worker {
+    explicit Worker(const FleetConfig &config)
+        : ids(config.batch_vehicles),
+          packets(config.max_steps_per_vehicle),
+          steps(0),
+          batches(0),
+          pinned(false) {}
+    ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+    std::vector<std::size_t> ids;
+    std::vector<Packet> packets;
+    LatencyHistogram latency;
+    std::uint64_t steps;
+    std::uint64_t batches;
+    bool pinned;
+  };
+
+  static std::int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static void merge(const Worker &w, FleetReport &report) {
+    report.steps += w.steps;
+    report.batches += w.batches;
+    report.pinned += w.pinned ? 1 : 0;
+    report.latency.merge(w.latency);
+  }
+
+  void schedule(std::size_t vehicle) noexcept {
+    if (!pool_[vehicle].scheduled.exchange(true, std::memory_order_acq_rel)) {
+      // Never full: each vehicle is queued at most once
+      ready_.try_push(vehicle);
+    }
+  }
+
+  //! Run the pending packets of a vehicle owned by the calling worker
+  std::size_t service(std::size_t vehicle, Worker &w) noexcept {
+    Vehicle &v = pool_[vehicle];
+    const std::size_t n = v.inbox.pop_batch(w.packets.data(), w.packets.size());
+    for (std::size_t i = 0; i < n; ++i) {
+      const Vector3 gravitation =
+          geodetic::gravitation_ecef<GeodeMdl>(v.state.position);
+      mechanization::ecef::fwd_pva_S03_rt<GeodeMdl>(
+          v.state, gravitation, w.packets[i].sample, v.state);
+    }
+    v.count += n;
+    v.published.store(PublishedState{v.count, v.state});
+    const std::int64_t now = now_ns();
+    for (std::size_t i = 0; i < n; ++i) {
+      w.latency.record(static_cast<std::uint64_t>(
+          now > w.packets[i].submitted_ns ? now - w.packets[i].submitted_ns
+                                          : 0));
+    }
+
+    // Release ownership, then pick up packets that raced with the release
+    v.scheduled.store(false, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (v.inbox.size() > 0) schedule(vehicle);
+    return n;
+  }
+
+  std::size_t run_batch(Worker &w) noexcept {
+    std::size_t count = 0;
+    while (count < w.ids.size() && ready_.try_pop(w.ids[count])) ++count;
+    if (count == 0) return 0;
+    std::size_t steps = 0;
+    for (std::size_t i = 0; i < count; ++i) steps += service(w.ids[i], w);
+    w.steps += steps;
+    ++w.batches;
+    return steps;
+  }
+
+  void work(std::size_t index) {
+    Worker &w = *workers_[index];
+    if (config_.pin_threads) w.pinned = pin(index);
+    int idle = 0;
+    while (!stop_.load(std::memory_order_acquire)) {
+      if (run_batch(w) > 0) {
+        idle = 0;
+      } else if (++idle < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+  }
+
+  bool pin(std::size_t index) const {
+#if defined(__linux__)
+    const unsigned cores = std::thread::hardware_concurrency();
+    if (cores == 0) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((config_.first_core + index) % cores, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)index;
+    return false;
+#endif
+  }
+
+  const FleetConfig config_;
+  const std::size_t vehicles_;
+  std::unique_ptr<Vehicle[]> pool_;
+  MpmcQueue<std::size_t> ready_;
+  std::unique_ptr<Worker> caller_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_;
+  bool running_;
+  std::chrono::steady_clock::time_point started_;
+  double seconds_ = 0.0;
+};
+
+}  // namespace realtime
+}  // namespace ennui
@@ -0,0 +1,125 @@
+/**
+ * @file imu_ingest.hpp
+ * @brief Lock-free hand-off of IMU samples to the ECEF mechanization
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "ecef.hpp"
+#include "ennui_types.hpp"
+#include "gravitation.hpp"
+#include "seqlock.hpp"
+#include "spsc_ring.hpp"
+
+namespace ennui {
+namespace realtime {
+
+//! Propagated state tagged with the number of samples consumed so far
+struct PublishedState {
+  std::uint64_t sample_count;
+  StatePvaSO3 state;
+};
+
+/**
+ * @brief Real-time IMU ingest: acquisition thread to propagation thread
+ *
+ * @tparam GeodeMdl geodetic model
+ * @tparam Capacity ring size in samples, must be a power of two
+ * @tparam MaxBatch largest number of samples drained per batch
+ *
+ * The acquisition thread calls push(); the propagation thread calls drain() or
+ * run(). Samples cross threads through an SpscRing, so neither side takes a
+ * lock. After each drained batch the latest state is published through a
+ * SeqLock, which any number of reader threads may poll with latest() without
+ * ever blocking the propagator.
+ *
+ * Instances are large (the ring is stored inline), so allocate them on the
+ * heap or in static storage. A new-expression keeps the producer and consumer
+ * members on separate cache lines even before C++17, as the class supplies a
+ * cache-line aligned operator new; std::make_shared does not use it.
+ */
+template <class GeodeMdl, std::size_t Capacity = 1024,
+          std::size_t MaxBatch = 64>
+class ImuIngest {
+ public:
+  //! Construct from the initial state
+  explicit ImuIngest(const StatePvaSO3 &initial)
+      : state_(initial), count_(0), dropped_(0) {
+    published_.store(PublishedState{0, initial});
+  }
+  ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @brief Producer: enqueue one sample
+   *
+   * @return false (and the sample is counted as dropped) if the ring is full
+   */
+  bool push(const ImuSample &sample) noexcept {
+    if (ring_.try_push(sample)) return true;
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  /**
+   * @brief Consumer: propagate one batch of queued samples
+   *
+   * @return number of samples propagated (0 if the ring was empty)
+   *
+   * Gravitation is evaluated at the prior position of each step. Each step is
+   * the allocation-free mechanization::ecef::fwd_pva_S03_rt, updated in place.
+   */
+  std::size_t drain() noexcept {
+    const std::size_t n = ring_.pop_batch(batch_, MaxBatch);
+    if (n == 0) return 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      const Vector3 gravitation =
+          geodetic::gravitation_ecef<GeodeMdl>(state_.position);
+      mechanization::ecef::fwd_pva_S03_rt<GeodeMdl>(state_, gravitation,
+                                                    batch_[i], state_);
+    }
+    count_ += n;
+    published_.store(PublishedState{count_, state_});
+    return n;
+  }
+
+  /**
+   * @brief Consumer loop: drain until stop is set and the ring is empty
+   *
+   * Yields the core when no samples are pending.
+   */
+  void run(const std::atomic<bool> &stop) {
+    for (;;) {
+      if (drain() > 0) continue;
+      if (stop.load(std::memory_order_acquire) && ring_.size() == 0) return;
+      std::this_thread::yield();
+    }
+  }
+
+  //! Any thread: most recently published state (never blocks the propagator)
+  PublishedState latest() const noexcept { return published_.load(); }
+
+  //! Any thread: number of samples rejected because the ring was full
+  std::uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  //! Consumer: current state (only safe to call from the consumer thread)
+  const StatePvaSO3 &state() const noexcept { return state_; }
+
+ private:
+  SpscRing<ImuSample, Capacity> ring_;
+  SeqLock<PublishedState> published_;
+  // Consumer-owned working data
+  StatePvaSO3 state_;
+  std::uint64_t count_;
+  ImuSample batch_[MaxBatch];
+  std::atomic<std::uint64_t> dropped_;
+};
+
+}  // namespace realtime
+}  // namespace ennui
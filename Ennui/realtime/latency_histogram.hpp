@@ -0,0 +1,114 @@
+/**
+ * @file latency_histogram.hpp
+ * @brief Fixed-memory latency histogram with percentile queries
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace ennui {
+namespace realtime {
+
+/**
+ * @brief Log-linear histogram of durations in nanoseconds
+ *
+ * Durations are binned into power-of-two ranges, each split into
+ * 2^SUB_BITS linear sub-buckets, bounding the relative quantization error
+ * of any percentile to 2^-SUB_BITS (about 3%). Memory is fixed at
+ * construction and record() is constant time and allocation-free, so the
+ * histogram can sit on a real-time path.
+ */
+class LatencyHistogram {
+ public:
+  //! Linear sub-buckets per power of two, as a bit count
+  static constexpr int SUB_BITS = 5;
+
+  LatencyHistogram() { reset(); }
+
+  //! Clear all recorded durations
+  void reset() noexcept {
+    for (int i = 0; i < BUCKETS; ++i) counts_[i] = 0;
+    count_ = 0;
+    max_ = 0;
+    sum_ = 0;
+  }
+
+  //! Record one duration in nanoseconds
+  void record(std::uint64_t ns) noexcept {
+    ++counts_[bucket_of(ns)];
+    ++count_;
+    sum_ += ns;
+    if (ns > max_) max_ = ns;
+  }
+
+  //! Accumulate the contents of another histogram
+  void merge(const LatencyHistogram &other) noexcept {
+    for (int i = 0; i < BUCKETS; ++i) counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_) max_ = other.max_;
+  }
+
+  //! Number of recorded durations
+  std::uint64_t count() const noexcept { return count_; }
+
+  //! Largest recorded duration (exact)
+  std::uint64_t max() const noexcept { return max_; }
+
+  //! Mean recorded duration
+  double mean() const noexcept {
+    return count_ ? static_cast<double>(sum_) / count_ : 0.0;
+  }
+
+  /**
+   * @brief Duration below which a fraction of recorded durations fall
+   *
+   * @param fraction quantile in [0, 1], e.g. 0.999 for p99.9
+   * @return upper edge of the bucket holding the quantile, capped at max()
+   */
+  std::uint64_t percentile(double fraction) const noexcept {
+    if (count_ == 0) return 0;
+    std::uint64_t rank = static_cast<std::uint64_t>(fraction * count_ + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count_) rank = count_;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        const std::uint64_t edge = upper_edge(i);
+        return edge < max_ ? edge : max_;
+      }
+    }
+    return max_;
+  }
+
+ private:
+  static constexpr int SUB_COUNT = 1 << SUB_BITS;
+  // One linear range below SUB_COUNT, then one range per remaining bit
+  static constexpr int BUCKETS = SUB_COUNT * (64 - SUB_BITS + 1);
+
+  static int bucket_of(std::uint64_t ns) noexcept {
+    if (ns < static_cast<std::uint64_t>(SUB_COUNT)) return static_cast<int>(ns);
+    int msb = 63;
+    while (!(ns >> msb)) --msb;
+    const int shift = msb - SUB_BITS;
+    const int sub = static_cast<int>((ns >> shift) & (SUB_COUNT - 1));
+    return SUB_COUNT * (shift + 1) + sub;
+  }
+
+  static std::uint64_t upper_edge(int bucket) noexcept {
+    if (bucket < SUB_COUNT) return static_cast<std::uint64_t>(bucket);
+    const int shift = bucket / SUB_COUNT - 1;
+    const std::uint64_t sub = static_cast<std::uint64_t>(bucket % SUB_COUNT);
+    return ((static_cast<std::uint64_t>(SUB_COUNT) + sub + 1) << shift) - 1;
+  }
+
+  std::uint64_t counts_[BUCKETS];
+  std::uint64_t count_;
+  std::uint64_t max_;
+  std::uint64_t sum_;
+};
+
+}  // namespace realtime
+}  // namespace ennui
@@ -0,0 +1,121 @@
+/**
+ * @file mpmc_queue.hpp
+ * @brief Bounded, lock-free, multi-producer/multi-consumer queue
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "cache_line.hpp"
+
+namespace ennui {
+namespace realtime {
+
+/**
+ * @brief Bounded multi-producer/multi-consumer queue
+ *
+ * @tparam T element type, copied in and out of the queue
+ *
+ * Any number of threads may push and pop concurrently. Each slot carries a
+ * sequence number that tells producers and consumers whose turn it is, so an
+ * operation is one compare-and-swap on the shared index plus a store to the
+ * slot. Capacity is rounded up to a power of two and allocated once at
+ * construction.
+ *
+ * See D. Vyukov, "Bounded MPMC queue" (1024cores.net).
+ */
+template <class T>
+class MpmcQueue {
+ public:
+  explicit MpmcQueue(std::size_t capacity)
+      : mask_(round_up(capacity) - 1),
+        cells_(new Cell[mask_ + 1]),
+        enqueue_(0),
+        dequeue_(0) {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+  ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+
+  //! Number of slots
+  std::size_t capacity() const noexcept { return mask_ + 1; }
+
+  //! Any thread: enqueue, false if the queue is full
+  bool try_push(const T &value) noexcept {
+    std::size_t pos = enqueue_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & mask_];
+      const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //! Any thread: dequeue, false if the queue is empty
+  bool try_pop(T &value) noexcept {
+    std::size_t pos = dequeue_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & mask_];
+      const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) -
+                                  static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          value = cell.value;
+          cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //! Any thread: approximate number of queued elements
+  std::size_t size() const noexcept {
+    const std::size_t enqueue = enqueue_.load(std::memory_order_acquire);
+    const std::size_t dequeue = dequeue_.load(std::memory_order_acquire);
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  static std::size_t round_up(std::size_t n) {
+    std::size_t capacity = 2;
+    while (capacity < n) capacity <<= 1;
+    return capacity;
+  }
+
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> enqueue_;
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> dequeue_;
+};
+
+}  // namespace realtime
+}  // namespace ennui
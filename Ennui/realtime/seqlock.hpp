@@ -0,0 +1,81 @@
+/**
+ * @file seqlock.hpp
+ * @brief Single-writer sequence lock for publishing plain-data snapshots
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "cache_line.hpp"
+
+namespace ennui {
+namespace realtime {
+
+/**
+ * @brief Single-writer, multi-reader sequence lock
+ *
+ * @tparam T plain-data value (no owning pointers), copied bytewise
+ *
+ * The writer never waits on readers: it bumps the sequence to an odd value,
+ * copies the value, then bumps the sequence to the next even value. Readers
+ * copy the value and retry if the sequence was odd or changed meanwhile, so a
+ * slow reader can only delay itself. Values are copied with memcpy between
+ * fences, which keeps torn reads invisible to the caller.
+ */
+template <class T>
+class SeqLock {
+ public:
+  SeqLock() : sequence_(0) { std::memset(storage_, 0, sizeof(T)); }
+  explicit SeqLock(const T &value) : sequence_(0) {
+    std::memcpy(storage_, static_cast<const void *>(&value), sizeof(T));
+  }
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+  ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+
+  //! Writer: publish a new value (single writer only)
+  void store(const T &value) noexcept {
+    const std::uint64_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(storage_, static_cast<const void *>(&value), sizeof(T));
+    sequence_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Reader: single attempt to copy a consistent value
+   *
+   * @param[out] value destination, only valid if true is returned
+   * @return false if the writer was active during the copy
+   */
+  bool try_load(T &value) const noexcept {
+    const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before & 1) return false;
+    std::memcpy(static_cast<void *>(&value), storage_, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return before == sequence_.load(std::memory_order_relaxed);
+  }
+
+  //! Reader: copy a consistent value, retrying while the writer is active
+  T load() const noexcept {
+    T value;
+    while (!try_load(value)) {
+    }
+    return value;
+  }
+
+  //! Number of completed stores
+  std::uint64_t version() const noexcept {
+    return sequence_.load(std::memory_order_acquire) / 2;
+  }
+
+ private:
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> sequence_;
+  alignas(alignof(T) > 8 ? alignof(T) : 8) unsigned char storage_[sizeof(T)];
+};
+
+}  // namespace realtime
+}  // namespace ennui
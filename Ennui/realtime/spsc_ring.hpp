@@ -0,0 +1,102 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief Bounded, lock-free, single-producer/single-consumer ring buffer
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "cache_line.hpp"
+
+namespace ennui {
+namespace realtime {
+
+/**
+ * @brief Bounded single-producer/single-consumer ring buffer
+ *
+ * @tparam T element type, copied in and out of the ring
+ * @tparam Capacity number of slots, must be a power of two
+ *
+ * Exactly one thread may call the producer methods (try_push) and exactly one
+ * thread may call the consumer methods (try_pop, pop_batch). Neither side
+ * blocks or allocates. Head and tail indices live on separate cache lines, and
+ * each side keeps a cached copy of the other side's index so that the shared
+ * index is only re-read when the ring appears full (producer) or empty
+ * (consumer).
+ */
+template <class T, std::size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+ public:
+  SpscRing() : head_(0), tail_cache_(0), tail_(0), head_cache_(0) {}
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+  ENNUI_CACHE_ALIGNED_OPERATOR_NEW
+
+  //! Number of slots in the ring
+  static constexpr std::size_t capacity() { return Capacity; }
+
+  //! Producer: append one element, false if the ring is full
+  bool try_push(const T &value) noexcept {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == Capacity) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == Capacity) return false;
+    }
+    slots_[tail & MASK] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //! Consumer: remove the oldest element, false if the ring is empty
+  bool try_pop(T &value) noexcept { return pop_batch(&value, 1) == 1; }
+
+  /**
+   * @brief Consumer: remove up to max_count of the oldest elements
+   *
+   * @param[out] out destination for at least max_count elements
+   * @param[in] max_count maximum number of elements to remove
+   * @return number of elements removed
+   *
+   * The shared tail index is read at most once and the head index published
+   * once per batch, which amortizes cross-core traffic over the batch.
+   */
+  std::size_t pop_batch(T *out, std::size_t max_count) noexcept {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    std::size_t available = tail_cache_ - head;
+    if (available < max_count) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      available = tail_cache_ - head;
+    }
+    const std::size_t count = available < max_count ? available : max_count;
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i] = slots_[(head + i) & MASK];
+    }
+    if (count > 0) head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  //! Approximate number of queued elements (exact if both sides are idle)
+  std::size_t size() const noexcept {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr std::size_t MASK = Capacity - 1;
+
+  // Consumer-owned index and its cached view of the producer index
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_;
+  std::size_t tail_cache_;
+  // Producer-owned index and its cached view of the consumer index
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_;
+  std::size_t head_cache_;
+  alignas(CACHE_LINE_SIZE) T slots_[Capacity];
+};
+
+}  // namespace realtime
+}  // namespace ennui
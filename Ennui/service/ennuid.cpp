@@ -0,0 +1,63 @@
+/**
+ * @file ennuid.cpp
+ * @brief Local propagation daemon executable
+ *
+ *     ennuid [socket_path]
+ *
+ * The default socket is $XDG_RUNTIME_DIR/ennui.sock, or /tmp/ennui-<uid>.sock
+ * when XDG_RUNTIME_DIR is not set. Runs until SIGINT or SIGTERM.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "kernels.hpp"
+#include "service_server.hpp"
+
+namespace {
+
+std::string default_socket_path() {
+  const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+  if (runtime != nullptr && runtime[0] != '\0') {
+    return std::string(runtime) + "/ennui.sock";
+  }
+  return "/tmp/ennui-" + std::to_string(::getuid()) + ".sock";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const std::string path = argc > 1 ? argv[1] : default_socket_path();
+
+  // Signals are taken synchronously, here, rather than by the server threads
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    ennui::service::ServiceServer server(path);
+    std::cout << "ennuid: listening on " << path << " ("
+              << ennui::kernels::isa_name(ennui::kernels::active_isa())
+              << " kernels)" << std::endl;
+    std::thread acceptor([&server]() { server.run(); });
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+    acceptor.join();
+    const ennui::service::ServiceStats stats = server.stats();
+    std::cout << "ennuid: " << stats.clients << " clients, " << stats.requests
+              << " requests, " << stats.records << " records" << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << "ennuid: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file service_client.cpp
+ * @brief Client of the local shared-memory propagation service
+ */
+
+#include "service_client.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "socket_io.hpp"
+
+namespace ennui {
+namespace service {
+
+namespace {
+
+//! Unique segment name for this process
+std::string segment_name() {
+  static std::atomic<unsigned> counter(0);
+  char name[SEGMENT_NAME_SIZE];
+  std::snprintf(name, sizeof(name), "/ennui-%ld-%u",
+                static_cast<long>(::getpid()), counter.fetch_add(1));
+  return name;
+}
+
+void check(const Response &response, const char *what) {
+  if (response.magic != PROTOCOL_MAGIC) {
+    throw std::runtime_error(std::string(what) + ": malformed response");
+  }
+  if (response.status != static_cast<std::int32_t>(Status::OK)) {
+    throw std::runtime_error(std::string(what) + ": service status " +
+                             std::to_string(response.status));
+  }
+}
+
+}  // namespace
+
+ServiceClient::ServiceClient(const std::string &socket_path,
+                             std::size_t segment_bytes)
+    : fd_(-1), segment_(nullptr), segment_bytes_(segment_bytes) {
+  sockaddr_un address;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                            "service socket path " + socket_path);
+  }
+
+  // Segment: created here, unlinked once the server has mapped it
+  const std::string name = segment_name();
+  const int shm = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (shm < 0) {
+    throw std::system_error(errno, std::generic_category(), "shm_open");
+  }
+  void *mapping = MAP_FAILED;
+  if (::ftruncate(shm, static_cast<off_t>(segment_bytes)) == 0) {
+    mapping = ::mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, shm, 0);
+  }
+  const int error = errno;
+  ::close(shm);
+  if (mapping == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    throw std::system_error(error, std::generic_category(), "mmap");
+  }
+  segment_ = static_cast<double *>(mapping);
+
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, socket_path.c_str());
+  if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr *>(&address),
+                           sizeof(address)) != 0) {
+    const int connect_error = errno;
+    ::shm_unlink(name.c_str());
+    release();
+    throw std::system_error(connect_error, std::generic_category(),
+                            "connect " + socket_path);
+  }
+
+  Request request;
+  std::memset(&request, 0, sizeof(request));
+  request.magic = PROTOCOL_MAGIC;
+  request.op = static_cast<std::uint32_t>(Op::ATTACH);
+  request.count = segment_bytes;
+  std::strncpy(request.segment, name.c_str(), SEGMENT_NAME_SIZE - 1);
+  Response response;
+  try {
+    response = exchange(request);
+  } catch (...) {
+    ::shm_unlink(name.c_str());
+    release();
+    throw;
+  }
+  ::shm_unlink(name.c_str());
+  if (response.status != static_cast<std::int32_t>(Status::OK)) {
+    release();
+    check(response, "attach");
+  }
+}
+
+ServiceClient::~ServiceClient() { release(); }
+
+void ServiceClient::release() {
+  if (fd_ >= 0) ::close(fd_);
+  if (segment_ != nullptr) ::munmap(segment_, segment_bytes_);
+  fd_ = -1;
+  segment_ = nullptr;
+}
+
+Response ServiceClient::exchange(const Request &request) {
+  Response response;
+  if (!detail::write_full(fd_, &request, sizeof(request)) ||
+      !detail::read_full(fd_, &response, sizeof(response))) {
+    throw std::system_error(errno ? errno : ECONNRESET,
+                            std::generic_category(), "service connection");
+  }
+  return response;
+}
+
+Response ServiceClient::call(Op op, std::uint64_t count,
+                             std::uint64_t input_offset,
+                             std::uint64_t output_offset) {
+  Request request;
+  std::memset(&request, 0, sizeof(request));
+  request.magic = PROTOCOL_MAGIC;
+  request.op = static_cast<std::uint32_t>(op);
+  request.count = count;
+  request.input_offset = input_offset;
+  request.output_offset = output_offset;
+  return exchange(request);
+}
+
+void ServiceClient::propagate(const StatePvaSO3 &initial,
+                              const ImuSample *samples, std::size_t count,
+                              StatePvaSO3 *states) {
+  // Layout: initial state, samples, then states
+  const std::size_t input = STATE_RECORD + IMU_RECORD * count;
+  if (sizeof(double) * (input + STATE_RECORD * count) > segment_bytes_) {
+    throw std::runtime_error("propagate: batch larger than the segment");
+  }
+  write_state(initial, segment_);
+  for (std::size_t i = 0; i < count; ++i) {
+    write_imu(samples[i], segment_ + STATE_RECORD + IMU_RECORD * i);
+  }
+  check(call(Op::PROPAGATE, count, 0, sizeof(double) * input), "propagate");
+  for (std::size_t i = 0; i < count; ++i) {
+    states[i] = read_state(segment_ + input + STATE_RECORD * i);
+  }
+}
+
+void ServiceClient::vector_op(Op op, const double *input, double *output,
+                              std::size_t count) {
+  const std::size_t doubles = VECTOR_RECORD * count;
+  if (2 * sizeof(double) * doubles > segment_bytes_) {
+    throw std::runtime_error("service: batch larger than the segment");
+  }
+  std::memcpy(segment_, input, sizeof(double) * doubles);
+  check(call(op, count, 0, sizeof(double) * doubles), "service");
+  std::memcpy(output, segment_ + doubles, sizeof(double) * doubles);
+}
+
+void ServiceClient::gravitation_ecef(const double *positions,
+                                     double *gravitation, std::size_t count) {
+  vector_op(Op::GRAVITATION_ECEF, positions, gravitation, count);
+}
+
+void ServiceClient::position_geodetic_to_ecef(const double *positions_llh,
+                                              double *positions_ecef,
+                                              std::size_t count) {
+  vector_op(Op::GEODETIC_TO_ECEF, positions_llh, positions_ecef, count);
+}
+
+}  // namespace service
+}  // namespace ennui
@@ -0,0 +1,75 @@
+/**
+ * @file service_client.hpp
+ * @brief Client of the local shared-memory propagation service
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ennui_types.hpp"
+#include "service_protocol.hpp"
+
+namespace ennui {
+namespace service {
+
+/**
+ * @brief Connection to a ServiceServer with its own shared-memory segment
+ *
+ * Two ways to use it:
+ *
+ * - zero-copy: write records into segment(), call() with their offsets and
+ *   read the results from segment();
+ * - convenience: propagate(), gravitation_ecef() and
+ *   position_geodetic_to_ecef() copy to and from caller arrays.
+ *
+ * Errors (connection, protocol status, batch too large for the segment) throw
+ * std::system_error or std::runtime_error. Not thread-safe: use one client per
+ * thread.
+ */
+class ServiceClient {
+ public:
+  /**
+   * @param[in] socket_path path of the server's socket
+   * @param[in] segment_bytes size of the shared-memory segment
+   */
+  ServiceClient(const std::string &socket_path, std::size_t segment_bytes);
+  ServiceClient(const ServiceClient &) = delete;
+  ServiceClient &operator=(const ServiceClient &) = delete;
+  ~ServiceClient();
+
+  //! Mapped segment, shared with the server
+  double *segment() { return segment_; }
+  std::size_t segment_bytes() const { return segment_bytes_; }
+
+  //! Send one request on records already in the segment
+  Response call(Op op, std::uint64_t count, std::uint64_t input_offset,
+                std::uint64_t output_offset);
+
+  //! Propagate initial through count samples into count states
+  void propagate(const StatePvaSO3 &initial, const ImuSample *samples,
+                 std::size_t count, StatePvaSO3 *states);
+
+  //! Batched WGS84 gravitation, 3 doubles per position
+  void gravitation_ecef(const double *positions, double *gravitation,
+                        std::size_t count);
+
+  //! Batched WGS84 geodetic to ECEF, 3 doubles per position
+  void position_geodetic_to_ecef(const double *positions_llh,
+                                 double *positions_ecef, std::size_t count);
+
+ private:
+  void release();
+  Response exchange(const Request &request);
+  void vector_op(Op op, const double *input, double *output,
+                 std::size_t count);
+
+  int fd_;
+  double *segment_;
+  std::size_t segment_bytes_;
+};
+
+}  // namespace service
+}  // namespace ennui
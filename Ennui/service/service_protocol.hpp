@@ -0,0 +1,132 @@
+/**
+ * @file service_protocol.hpp
+ * @brief Wire protocol of the local shared-memory propagation service
+ *
+ * A client creates a POSIX shared-memory segment and connects to the daemon's
+ * Unix socket. Every message on the socket is a fixed-size Request answered
+ * by a fixed-size Response; bulk data never crosses the socket. The first
+ * request attaches the segment by name, after which each request names an
+ * operation, a record count and byte offsets of its input and output in the
+ * segment. The daemon reads the input and writes the output in place, so the
+ * client reads results straight from its own mapping.
+ *
+ * The daemon opens any segment name a connecting client supplies, with the
+ * daemon's own permissions. Run it as the user it serves: the socket is
+ * created accessible to that user only, so other users cannot connect.
+ *
+ * Records are plain little-endian doubles, independent of the build's matrix
+ * storage order, so the Python and MATLAB shims can address them directly:
+ *
+ * - IMU record (8): time, dt, specific force (3), angular rate (3)
+ * - state record (16): time, position (3), velocity (3), attitude (9, rows)
+ * - vector record (3)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ennui_types.hpp"
+
+namespace ennui {
+namespace service {
+
+//! First field of every message, "ENSV"
+static constexpr std::uint32_t PROTOCOL_MAGIC = 0x56534e45;
+
+//! Largest segment name, including the terminating null
+static constexpr std::size_t SEGMENT_NAME_SIZE = 64;
+
+//! Doubles per record
+static constexpr std::size_t IMU_RECORD = 8;
+static constexpr std::size_t STATE_RECORD = 16;
+static constexpr std::size_t VECTOR_RECORD = 3;
+
+//! Requested operation
+enum class Op : std::uint32_t {
+  //! Map the segment named in Request::segment, of Request::count bytes
+  ATTACH = 1,
+  //! Input: one state record then count IMU records; output: count states
+  PROPAGATE = 2,
+  //! Input: count ECEF positions; output: count gravitation vectors (WGS84)
+  GRAVITATION_ECEF = 3,
+  //! Input: count (lat [deg], lon [deg], h [m]); output: count ECEF positions
+  GEODETIC_TO_ECEF = 4,
+};
+
+//! Outcome of a request
+enum class Status : std::int32_t {
+  OK = 0,
+  BAD_REQUEST = -1,    //!< wrong magic, unknown operation or overlap
+  NOT_ATTACHED = -2,   //!< no segment attached yet
+  OUT_OF_RANGE = -3,   //!< outside the segment, or segment shrunk (detached)
+  ATTACH_FAILED = -4,  //!< segment could not be mapped
+  // Reported by client bindings, never sent by the daemon
+  UNAVAILABLE = -5,        //!< binding built without the service
+  CONNECTION_FAILED = -6,  //!< connection to the daemon failed or was lost
+};
+
+//! Client to daemon
+struct Request {
+  std::uint32_t magic;
+  std::uint32_t op;
+  std::uint64_t count;
+  std::uint64_t input_offset;   //!< bytes from the start of the segment
+  std::uint64_t output_offset;  //!< bytes from the start of the segment
+  char segment[SEGMENT_NAME_SIZE];
+};
+
+//! Daemon to client
+struct Response {
+  std::uint32_t magic;
+  std::int32_t status;
+  std::uint64_t count;  //!< records processed
+  double seconds;       //!< time spent computing, in the daemon
+};
+
+static_assert(sizeof(Request) == 96, "Request layout is part of the protocol");
+static_assert(sizeof(Response) == 24,
+              "Response layout is part of the protocol");
+
+//! Read an IMU record
+inline ImuSample read_imu(const double *record) {
+  return ImuSample{record[0], record[1],
+                   Vector3{record[2], record[3], record[4]},
+                   Vector3{record[5], record[6], record[7]}};
+}
+
+//! Write an IMU record
+inline void write_imu(const ImuSample &sample, double *record) {
+  record[0] = sample.time;
+  record[1] = sample.dt;
+  for (int i = 0; i < 3; ++i) {
+    record[2 + i] = sample.specific_force[i];
+    record[5 + i] = sample.angular_rate[i];
+  }
+}
+
+//! Read a state record
+inline StatePvaSO3 read_state(const double *record) {
+  StatePvaSO3 state;
+  state.time = record[0];
+  for (int i = 0; i < 3; ++i) {
+    state.position[i] = record[1 + i];
+    state.velocity[i] = record[4 + i];
+    for (int j = 0; j < 3; ++j) state.attitude(i, j) = record[7 + 3 * i + j];
+  }
+  return state;
+}
+
+//! Write a state record
+inline void write_state(const StatePvaSO3 &state, double *record) {
+  record[0] = state.time;
+  for (int i = 0; i < 3; ++i) {
+    record[1 + i] = state.position[i];
+    record[4 + i] = state.velocity[i];
+    for (int j = 0; j < 3; ++j) record[7 + 3 * i + j] = state.attitude(i, j);
+  }
+}
+
+}  // namespace service
+}  // namespace ennui
@@ -0,0 +1,321 @@
+/**
+ * @file service_server.cpp
+ * @brief Local propagation daemon
+ */
+
+#include "service_server.hpp"
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <type_traits>
+
+#include "kernels.hpp"
+#include "socket_io.hpp"
+
+namespace ennui {
+namespace service {
+
+namespace {
+
+//! Records per kernel call when propagating
+const std::size_t CHUNK = 256;
+
+//! [offset, offset + bytes) lies in a segment of size bytes, 8-byte aligned
+bool in_segment(std::uint64_t offset, std::uint64_t bytes, std::size_t size) {
+  return offset % sizeof(double) == 0 && offset <= size &&
+         bytes <= size - offset;
+}
+
+// A client can shrink its segment after ATTACH, and the daemon's next access
+// past the new end of the file raises SIGBUS. While a thread works on a
+// segment, segment_guard points at its jump buffer and the handler returns
+// there; the request fails instead of the process dying. Faults outside a
+// guarded section restore the previous handler, which then sees the fault.
+thread_local sigjmp_buf *segment_guard = nullptr;
+struct sigaction previous_sigbus;
+
+void on_sigbus(int, siginfo_t *, void *) {
+  sigjmp_buf *guard = segment_guard;
+  if (guard != nullptr) siglongjmp(*guard, 1);
+  ::sigaction(SIGBUS, &previous_sigbus, nullptr);
+}
+
+void install_sigbus_handler() {
+  static std::once_flag once;
+  std::call_once(once, []() {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_sigbus;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (::sigaction(SIGBUS, &action, &previous_sigbus) != 0) {
+      throw std::system_error(errno, std::generic_category(), "sigaction");
+    }
+  });
+}
+
+// A SIGBUS jumps out of compute() without running destructors
+static_assert(std::is_trivially_destructible<StatePvaSO3>::value &&
+                  std::is_trivially_destructible<ImuSample>::value,
+              "records must be trivially destructible");
+
+// Run the operation on records already validated to lie in the segment
+void compute(Op op, std::uint64_t count, const double *input, double *output) {
+  switch (op) {
+    case Op::PROPAGATE: {
+      StatePvaSO3 state = read_state(input);
+      const double *records = input + STATE_RECORD;
+      ImuSample samples[CHUNK];
+      StatePvaSO3 states[CHUNK];
+      for (std::size_t begin = 0; begin < count; begin += CHUNK) {
+        const std::size_t n =
+            (std::min)(CHUNK, static_cast<std::size_t>(count - begin));
+        for (std::size_t i = 0; i < n; ++i) {
+          samples[i] = read_imu(records + IMU_RECORD * (begin + i));
+        }
+        kernels::propagate(state, samples, n, states);
+        for (std::size_t i = 0; i < n; ++i) {
+          write_state(states[i], output + STATE_RECORD * (begin + i));
+        }
+      }
+      break;
+    }
+    case Op::GRAVITATION_ECEF:
+      kernels::gravitation_ecef(input, output, count);
+      break;
+    default:  // Op::GEODETIC_TO_ECEF
+      kernels::position_geodetic_to_ecef(input, output, count);
+      break;
+  }
+}
+
+// Remove the socket file of a daemon that is no longer running. Anything
+// else at the path, including the socket of a live daemon, is left alone.
+void remove_stale_socket(const std::string &path, const sockaddr_un &address) {
+  struct stat info;
+  if (::lstat(path.c_str(), &info) != 0) return;  // nothing to replace
+  if (!S_ISSOCK(info.st_mode)) {
+    throw std::system_error(EEXIST, std::generic_category(),
+                            "service socket path " + path +
+                                " exists and is not a socket");
+  }
+  const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (probe < 0) {
+    throw std::system_error(errno, std::generic_category(), "socket");
+  }
+  const int connected = ::connect(
+      probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+  const int error = errno;
+  ::close(probe);
+  if (connected == 0) {
+    throw std::system_error(EADDRINUSE, std::generic_category(),
+                            "service already running on " + path);
+  }
+  if (error != ECONNREFUSED) {
+    throw std::system_error(error, std::generic_category(), "connect " + path);
+  }
+  ::unlink(path.c_str());
+}
+
+Response reply(Status status, std::uint64_t count = 0, double seconds = 0) {
+  return Response{PROTOCOL_MAGIC, static_cast<std::int32_t>(status), count,
+                  seconds};
+}
+
+}  // namespace
+
+ServiceServer::ServiceServer(const std::string &socket_path)
+    : socket_path_(socket_path),
+      listen_fd_(-1),
+      stopping_(false),
+      clients_(0),
+      requests_(0),
+      records_(0) {
+  sockaddr_un address;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                            "service socket path " + socket_path);
+  }
+  install_sigbus_handler();
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, socket_path.c_str());
+  remove_stale_socket(socket_path, address);
+  listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "socket");
+  }
+  // Owner only from the moment it exists, as the daemon opens whatever
+  // segment a client names (the umask is process-wide, restored at once)
+  const mode_t umask = ::umask(S_IRWXG | S_IRWXO);
+  const int bound = ::bind(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+                           sizeof(address));
+  const int bind_error = errno;
+  ::umask(umask);
+  errno = bind_error;
+  if (bound != 0 || ::listen(listen_fd_, 64) != 0) {
+    const int error = errno;
+    ::close(listen_fd_);
+    throw std::system_error(error, std::generic_category(),
+                            "bind " + socket_path);
+  }
+}
+
+ServiceServer::~ServiceServer() {
+  stop();
+  for (std::thread &t : threads_) t.join();
+  ::close(listen_fd_);
+  ::unlink(socket_path_.c_str());
+}
+
+void ServiceServer::run() {
+  while (!stopping_.load()) {
+    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return;  // shut down by stop()
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_.load()) {
+      ::close(fd);
+      return;
+    }
+    reap();
+    client_fds_.push_back(fd);
+    threads_.emplace_back([this, fd]() { serve(fd); });
+    clients_.fetch_add(1);
+  }
+}
+
+void ServiceServer::stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopping_.exchange(true)) return;
+  ::shutdown(listen_fd_, SHUT_RDWR);
+  for (const int fd : client_fds_) ::shutdown(fd, SHUT_RDWR);
+}
+
+// Join the threads of clients that have disconnected (mutex_ held)
+void ServiceServer::reap() {
+  for (const std::thread::id id : finished_) {
+    for (std::size_t i = 0; i < threads_.size(); ++i) {
+      if (threads_[i].get_id() != id) continue;
+      threads_[i].join();
+      threads_.erase(threads_.begin() + i);
+      break;
+    }
+  }
+  finished_.clear();
+}
+
+ServiceStats ServiceServer::stats() const {
+  return ServiceStats{clients_.load(), requests_.load(), records_.load()};
+}
+
+void ServiceServer::serve(int fd) {
+  void *base = nullptr;
+  std::size_t size = 0;
+  Request request;
+  while (detail::read_full(fd, &request, sizeof(request))) {
+    const Response response = handle(request, base, size);
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    if (!detail::write_full(fd, &response, sizeof(response))) break;
+  }
+  if (base != nullptr) ::munmap(base, size);
+  std::lock_guard<std::mutex> lock(mutex_);
+  client_fds_.erase(std::find(client_fds_.begin(), client_fds_.end(), fd));
+  ::close(fd);
+  finished_.push_back(std::this_thread::get_id());
+}
+
+Response ServiceServer::handle(const Request &request, void *&base,
+                               std::size_t &size) {
+  if (request.magic != PROTOCOL_MAGIC) return reply(Status::BAD_REQUEST);
+
+  const Op op = static_cast<Op>(request.op);
+  if (op == Op::ATTACH) {
+    char name[SEGMENT_NAME_SIZE];
+    std::memcpy(name, request.segment, SEGMENT_NAME_SIZE);
+    name[SEGMENT_NAME_SIZE - 1] = '\0';
+    const int shm = ::shm_open(name, O_RDWR, 0);
+    if (shm < 0) return reply(Status::ATTACH_FAILED);
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (::fstat(shm, &info) == 0 && request.count > 0 &&
+        request.count <= static_cast<std::uint64_t>(info.st_size)) {
+      mapping = ::mmap(nullptr, request.count, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, shm, 0);
+    }
+    ::close(shm);
+    if (mapping == MAP_FAILED) return reply(Status::ATTACH_FAILED);
+    if (base != nullptr) ::munmap(base, size);
+    base = mapping;
+    size = request.count;
+    return reply(Status::OK, request.count);
+  }
+  if (base == nullptr) return reply(Status::NOT_ATTACHED);
+
+  std::size_t input_doubles, output_doubles;
+  switch (op) {
+    case Op::PROPAGATE:
+      input_doubles = STATE_RECORD + IMU_RECORD * request.count;
+      output_doubles = STATE_RECORD * request.count;
+      break;
+    case Op::GRAVITATION_ECEF:
+    case Op::GEODETIC_TO_ECEF:
+      input_doubles = output_doubles = VECTOR_RECORD * request.count;
+      break;
+    default:
+      return reply(Status::BAD_REQUEST);
+  }
+  // Counts beyond the segment would overflow the byte arithmetic below
+  if (request.count > size) return reply(Status::OUT_OF_RANGE);
+  const std::uint64_t input_bytes = sizeof(double) * input_doubles;
+  const std::uint64_t output_bytes = sizeof(double) * output_doubles;
+  if (!in_segment(request.input_offset, input_bytes, size) ||
+      !in_segment(request.output_offset, output_bytes, size)) {
+    return reply(Status::OUT_OF_RANGE);
+  }
+  if (request.input_offset < request.output_offset + output_bytes &&
+      request.output_offset < request.input_offset + input_bytes) {
+    return reply(Status::BAD_REQUEST);
+  }
+
+  const double *input = reinterpret_cast<const double *>(
+      static_cast<const char *>(base) + request.input_offset);
+  double *output = reinterpret_cast<double *>(static_cast<char *>(base) +
+                                              request.output_offset);
+  const auto start = std::chrono::steady_clock::now();
+  sigjmp_buf guard;
+  if (sigsetjmp(guard, 1) != 0) {
+    // The segment shrank under us: drop it, the client may attach another
+    segment_guard = nullptr;
+    ::munmap(base, size);
+    base = nullptr;
+    size = 0;
+    return reply(Status::OUT_OF_RANGE);
+  }
+  segment_guard = &guard;
+  compute(op, request.count, input, output);
+  segment_guard = nullptr;
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  records_.fetch_add(request.count, std::memory_order_relaxed);
+  return reply(Status::OK, request.count, seconds);
+}
+
+}  // namespace service
+}  // namespace ennui
@@ -0,0 +1,85 @@
+/**
+ * @file service_server.hpp
+ * @brief Local propagation daemon: Unix-socket control, shared-memory data
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "service_protocol.hpp"
+
+namespace ennui {
+namespace service {
+
+//! Counters of a running server
+struct ServiceStats {
+  std::uint64_t clients;   //!< connections accepted
+  std::uint64_t requests;  //!< requests answered
+  std::uint64_t records;   //!< records processed
+};
+
+/**
+ * @brief Serves propagation and geodetic requests to local clients
+ *
+ * Listens on a Unix socket; each connection is served by its own thread, so
+ * clients proceed concurrently and one slow client does not hold up others.
+ * Computation goes through the precompiled kernels (WGS84), shared by all
+ * clients of the process. See service_protocol.hpp for the wire format.
+ *
+ * Clients name the shared-memory segment they attach, and the daemon opens any
+ * name it is given with its own permissions; the socket is therefore created
+ * under a umask that leaves it accessible to its owner only (the umask is
+ * briefly changed for the whole process). Access to a segment that its
+ * client has shrunk since attaching faults with SIGBUS; the server catches
+ * that (process-wide SIGBUS handler, installed on construction), detaches the
+ * segment and fails the request, and the other sessions are unaffected.
+ */
+class ServiceServer {
+ public:
+  /**
+   * @brief Bind and listen
+   *
+   * @param[in] socket_path file system path of the socket; a socket file
+   * left there by a daemon that is no longer running is replaced
+   * @throw std::system_error if a daemon is already listening on the path,
+   * the path exists and is not a socket, or the socket cannot be bound
+   */
+  explicit ServiceServer(const std::string &socket_path);
+  ServiceServer(const ServiceServer &) = delete;
+  ServiceServer &operator=(const ServiceServer &) = delete;
+  //! Stops, joins the client threads and removes the socket file
+  ~ServiceServer();
+
+  //! Accept and serve clients until stop()
+  void run();
+  //! Any thread: make run() return and disconnect all clients
+  void stop();
+
+  const std::string &socket_path() const { return socket_path_; }
+  ServiceStats stats() const;
+
+ private:
+  void serve(int fd);
+  void reap();
+  Response handle(const Request &request, void *&base, std::size_t &size);
+
+  std::string socket_path_;
+  int listen_fd_;
+  std::atomic<bool> stopping_;
+  std::mutex mutex_;
+  std::vector<int> client_fds_;
+  std::vector<std::thread> threads_;
+  std::vector<std::thread::id> finished_;
+  std::atomic<std::uint64_t> clients_;
+  std::atomic<std::uint64_t> requests_;
+  std::atomic<std::uint64_t> records_;
+};
+
+}  // namespace service
+}  // namespace ennui
@@ -0,0 +1,46 @@
+/**
+ * @file socket_io.hpp
+ * @brief Whole-message reads and writes on a stream socket
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <cstddef>
+
+namespace ennui {
+namespace service {
+namespace detail {
+
+//! Read exactly bytes; false on end of stream or error
+inline bool read_full(int fd, void *data, std::size_t bytes) {
+  char *p = static_cast<char *>(data);
+  while (bytes > 0) {
+    const ssize_t n = ::recv(fd, p, bytes, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    bytes -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+//! Write exactly bytes; false on error
+inline bool write_full(int fd, const void *data, std::size_t bytes) {
+  const char *p = static_cast<const char *>(data);
+  while (bytes > 0) {
+    const ssize_t n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    bytes -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+}  // namespace detail
+}  // namespace service
+}  // namespace ennui
@@ -41,6 +41,26 @@ namespace ecef {}
  * @brief namespace for geodetic models
  */
 namespace geodetic {}
+/**
+ * @namespace ennui::realtime
+ * @brief namespace for real-time ingest and lock-free hand-off
+ */
+namespace realtime {}
+/**
+ * @namespace ennui::io
+ * @brief namespace for trajectory file input and output
+ */
+namespace io {}
+/**
+ * @namespace ennui::analysis
+ * @brief namespace for navigation error analysis
+ */
+namespace analysis {}
+/**
+ * @namespace ennui::pipeline
+ * @brief namespace for streaming pipelines of processing stages
+ */
+namespace pipeline {}
 
 // Commonly used fixed size vectors
 typedef Eigen::Matrix<double, 1, 1, EIGEN_STORAGE> Scalar;
@@ -50,6 +70,7 @@ typedef Eigen::Vector4d Vector4;
 typedef Eigen::Matrix<double, 10, 1, EIGEN_STORAGE> Vector10;
 typedef Eigen::Matrix<double, 16, 1, EIGEN_STORAGE> Vector16;
 typedef Eigen::Matrix<double, 3, 3, EIGEN_STORAGE> Matrix3x3;
+typedef Eigen::Matrix<double, 9, 9, EIGEN_STORAGE> Matrix9x9;
 
 // Reference types for efficiency
 typedef const Eigen::Ref<const Vector3> ConstRefVector3;
@@ -61,4 +82,24 @@ typedef const Eigen::Map<const ennui::Matrix3x3> ConstMapMatrix3x3;
 typedef Eigen::Map<ennui::Vector3> MapVector3;
 typedef Eigen::Map<ennui::Matrix3x3> MapMatrix3x3;
 
+//! Inertial measurement (rates) held constant over a sampling interval
+struct ImuSample {
+  //! Time at the end of the sampling interval
+  double time;
+  //! Duration of the sampling interval
+  double dt;
+  //! Specific force as 3-vector
+  Vector3 specific_force;
+  //! Angular rate as 3-vector
+  Vector3 angular_rate;
+};
+
+//! Position, velocity, and attitude (3x3 matrix) state at a given time
+struct StatePvaSO3 {
+  double time;
+  Vector3 position;
+  Vector3 velocity;
+  Matrix3x3 attitude;
+};
+
 }  // namespace ennui
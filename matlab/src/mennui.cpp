@@ -6,14 +6,29 @@
 #include "ecef.hpp"
 #include "ennui_types.hpp"
 #include "gravitation.hpp"
+#include "kernels.hpp"
 #include "wgs84.hpp"
 
+#ifdef ENNUI_SERVICE
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "service_client.hpp"
+#else
+#include "service_protocol.hpp"
+#endif
+
 typedef ennui::geodetic::Wgs84 GeodeMdl;
 
+// Hot paths are routed through the precompiled kernels (WGS84), which select
+// the best instruction set for the host at load time.
+
 void geodetic::gravitation_ecef(const double position[3], double gamma[3]) {
-  const ennui::ConstMapVector3 p(position);
-  ennui::MapVector3 g(gamma);
-  g = ennui::geodetic::gravitation_ecef<GeodeMdl>(p);
+  ennui::kernels::gravitation_ecef(position, gamma, 1);
 }
 
 void mechanization::ecef::fwd_pva_S03(
@@ -30,6 +45,118 @@ void mechanization::ecef::fwd_pva_S03(
   ennui::MapVector3 pp(position_plus);
   ennui::MapVector3 vp(velocity_plus);
   ennui::MapMatrix3x3 ap(attitude_plus);
-  ennui::mechanization::ecef::fwd_pva_S03<GeodeMdl>(pm, vm, am, g, f, w, dt, pp,
-                                                    vp, ap);
+  ennui::Vector3 position, velocity;
+  ennui::Matrix3x3 attitude;
+  ennui::kernels::fwd_pva_S03(pm, vm, am, g, f, w, dt, position, velocity,
+                              attitude);
+  pp = position;
+  vp = velocity;
+  ap = attitude;
+}
+
+#ifdef ENNUI_SERVICE
+
+namespace {
+
+using ennui::service::Op;
+using ennui::service::ServiceClient;
+
+std::mutex clients_mutex;
+std::map<int, std::shared_ptr<ServiceClient>> clients;
+int next_handle = 1;
+
+std::shared_ptr<ServiceClient> client_of(int handle) {
+  std::lock_guard<std::mutex> lock(clients_mutex);
+  const auto it = clients.find(handle);
+  return it == clients.end() ? nullptr : it->second;
+}
+
+// Copy input records into the segment, run op, copy output records back
+int round_trip(int handle, Op op, const double *head, std::size_t head_size,
+               const double *input, std::size_t input_size, int count,
+               double *output, std::size_t output_size) {
+  const std::shared_ptr<ServiceClient> client = client_of(handle);
+  if (!client) return static_cast<int>(ennui::service::Status::NOT_ATTACHED);
+  const std::size_t n = count < 0 ? 0 : static_cast<std::size_t>(count);
+  const std::size_t in = head_size + input_size * n;
+  if (sizeof(double) * (in + output_size * n) > client->segment_bytes()) {
+    return static_cast<int>(ennui::service::Status::OUT_OF_RANGE);
+  }
+  double *segment = client->segment();
+  if (head_size > 0) std::memcpy(segment, head, sizeof(double) * head_size);
+  std::memcpy(segment + head_size, input, sizeof(double) * input_size * n);
+  try {
+    const ennui::service::Response response =
+        client->call(op, n, 0, sizeof(double) * in);
+    if (response.status != 0) return response.status;
+  } catch (const std::exception &) {
+    return static_cast<int>(ennui::service::Status::CONNECTION_FAILED);
+  }
+  std::memcpy(output, segment + in, sizeof(double) * output_size * n);
+  return 0;
+}
+
+}  // namespace
+
+int service::connect(const char *socket_path, double segment_megabytes) {
+  // Also rejects NaN, and sizes the conversion to size_t cannot represent
+  const double bytes = segment_megabytes * (1 << 20);
+  if (socket_path == nullptr || !(bytes >= 1) ||
+      bytes >= static_cast<double>(std::numeric_limits<std::size_t>::max())) {
+    return 0;
+  }
+  try {
+    std::shared_ptr<ServiceClient> client(
+        new ServiceClient(socket_path, static_cast<std::size_t>(bytes)));
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    clients[next_handle] = client;
+    return next_handle++;
+  } catch (const std::exception &) {
+    return 0;
+  }
 }
+
+void service::disconnect(int handle) {
+  std::lock_guard<std::mutex> lock(clients_mutex);
+  clients.erase(handle);
+}
+
+int service::propagate(int handle, const double initial_state[16],
+                       const double *imu, int count, double *states) {
+  return round_trip(handle, Op::PROPAGATE, initial_state,
+                    ennui::service::STATE_RECORD, imu,
+                    ennui::service::IMU_RECORD, count, states,
+                    ennui::service::STATE_RECORD);
+}
+
+int service::gravitation_ecef(int handle, const double *positions, int count,
+                              double *gravitation) {
+  return round_trip(handle, Op::GRAVITATION_ECEF, nullptr, 0, positions,
+                    ennui::service::VECTOR_RECORD, count, gravitation,
+                    ennui::service::VECTOR_RECORD);
+}
+
+int service::position_geodetic_to_ecef(int handle,
+                                       const double *positions_llh, int count,
+                                       double *positions_ecef) {
+  return round_trip(handle, Op::GEODETIC_TO_ECEF, nullptr, 0, positions_llh,
+                    ennui::service::VECTOR_RECORD, count, positions_ecef,
+                    ennui::service::VECTOR_RECORD);
+}
+
+#else
+
+// Built without the service: every call reports it as unavailable
+int service::connect(const char *, double) { return 0; }
+void service::disconnect(int) {}
+int service::propagate(int, const double[16], const double *, int, double *) {
+  return static_cast<int>(ennui::service::Status::UNAVAILABLE);
+}
+int service::gravitation_ecef(int, const double *, int, double *) {
+  return static_cast<int>(ennui::service::Status::UNAVAILABLE);
+}
+int service::position_geodetic_to_ecef(int, const double *, int, double *) {
+  return static_cast<int>(ennui::service::Status::UNAVAILABLE);
+}
+
+#endif
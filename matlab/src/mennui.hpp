@@ -24,3 +24,25 @@ mennui_EXPORT namespace mechanization {
         double attitude_plus[9]);
   }
 }
+
+// Client of the local propagation daemon (ennuid, POSIX only). Records are
+// laid out as in Ennui/service/service_protocol.hpp, one record per column of
+// a MATLAB array: IMU 8-by-count, states 16-by-count, vectors 3-by-count. In
+// definemennui.m, set the shape of each array argument to the count argument
+// scaled by its record size. Functions return 0 on success, or a negative
+// ennui::service::Status: UNAVAILABLE (-5) when built without the service,
+// CONNECTION_FAILED (-6) when the daemon cannot be reached.
+mennui_EXPORT namespace service {
+  //! Connect to ennuid; returns a handle, or 0 on failure or a segment size
+  //! that is not positive
+  mennui_EXPORT int connect(const char *socket_path, double segment_megabytes);
+  mennui_EXPORT void disconnect(int handle);
+  mennui_EXPORT int propagate(int handle, const double initial_state[16],
+                              const double *imu, int count, double *states);
+  mennui_EXPORT int gravitation_ecef(int handle, const double *positions,
+                                     int count, double *gravitation);
+  mennui_EXPORT int position_geodetic_to_ecef(int handle,
+                                              const double *positions_llh,
+                                              int count,
+                                              double *positions_ecef);
+}
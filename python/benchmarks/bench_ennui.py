@@ -0,0 +1,386 @@
+"""Throughput benchmark: pyennui (compiled) versus pure_ennui (NumPy)
+
+Sweeps call patterns - single calls, a Python loop over N samples, and the
+batched pyennui API - and records per-call time and numerical agreement
+between the two implementations. Results are written as JSON (to track from
+release to release) and as a Markdown table. A previous JSON report may be
+supplied to print relative speed.
+
+Runs offline with the standard library and NumPy only. Either implementation
+may be missing, in which case its cases are skipped.
+
+    python python/benchmarks/bench_ennui.py --json bench.json --markdown bench.md
+    python python/benchmarks/bench_ennui.py --compare previous.json
+"""
+
+import argparse
+import json
+import os
+import platform
+import sys
+import timeit
+
+import numpy as np
+
+# Pure-python implementation, importable from the source tree
+sys.path.append(os.path.join(os.path.dirname(__file__), "..", "reference"))
+
+try:
+    import pure_ennui.geodetic as pure_geodetic
+    import pure_ennui.math.rotation as pure_rotation
+    import pure_ennui.mechanization.ecef as pure_ecef
+except ImportError:  # pragma: no cover
+    pure_ennui_available = False
+else:
+    pure_ennui_available = True
+
+try:
+    import pyennui
+except ImportError:
+    pyennui = None
+
+
+# White House landmark, see tests/common/landmarks.cpp
+POSITION = np.array([1.115042345294169e06, -4.843812298149152e06, 3.983520216446271e06])
+VELOCITY = np.array([1.700252783993267e00, 5.799253612971604e00, -7.143100966293305e00])
+ATTITUDE = np.array(
+    [
+        [-1.689390579588263e-01, -4.453768089569571e-01, -8.792605374627603e-01],
+        [8.000355898459490e-01, -5.830041132072308e-01, 1.415954058693114e-01],
+        [-5.756758199506289e-01, -6.795187282384265e-01, 4.548094637289362e-01],
+    ]
+)
+
+
+def synthetic_imu(n, dt=1e-2):
+    """Deterministic, gently varying IMU samples"""
+    t = dt * np.arange(n)
+    f = np.column_stack([0.2 * np.sin(t), 0.1 * np.cos(0.5 * t), np.full(n, 9.81)])
+    w = np.column_stack([0.01 * np.cos(t), np.full(n, -0.02), 0.03 * np.sin(0.2 * t)])
+    return np.full(n, dt), f, w
+
+
+def synthetic_llh(n):
+    """Latitude/longitude sweep [deg, deg, m]"""
+    s = np.linspace(0.0, 1.0, n)
+    return np.column_stack([-80.0 + 160.0 * s, -180.0 + 360.0 * s, 100.0 + 0 * s])
+
+
+def pure_geodetic_to_ecef(llh):
+    """NumPy geodetic to ECEF, for comparison with the batched pyennui API
+
+    pure_ennui has no frame transformations; this follows Equation (4.A.2)
+    [@misra_global_2001] as in Ennui/geodetic/frame_transform.hpp"""
+    geode = pure_geodetic.wgs84
+    f = 1.0 / geode.EARTH_INVERSE_FLATTENING
+    e2 = 2.0 * f - f * f
+    phi = np.radians(llh[:, 0])
+    lam = np.radians(llh[:, 1])
+    h = llh[:, 2]
+    N = geode.EARTH_SEMIMAJOR_AXIS / np.sqrt(1 - e2 * np.sin(phi) ** 2)
+    return np.column_stack(
+        [
+            (N + h) * np.cos(phi) * np.cos(lam),
+            (N + h) * np.cos(phi) * np.sin(lam),
+            (N * (1 - e2) + h) * np.sin(phi),
+        ]
+    )
+
+
+# ---------------------------------------------------------------------------
+# Call patterns. Each returns a callable (the timed work) producing an array
+# used for the agreement check.
+
+
+def pure_step():
+    g = pure_geodetic.gravitation_ecef(POSITION)
+    dt, f, w = synthetic_imu(1)
+    return lambda: np.concatenate(
+        [
+            np.ravel(x)
+            for x in pure_ecef.fwd_pva_S03(
+                POSITION, VELOCITY, ATTITUDE, g, f[0], w[0], dt[0]
+            )
+        ]
+    )
+
+
+def py_step():
+    g = pyennui.geodetic.gravitation_ecef(POSITION)
+    dt, f, w = synthetic_imu(1)
+    p, v, a = np.zeros(3), np.zeros(3), np.zeros((3, 3))
+
+    def work():
+        pyennui.mechanization.ecef.fwd_pva_S03(
+            POSITION, VELOCITY, ATTITUDE, g, f[0], w[0], dt[0], p, v, a
+        )
+        return np.concatenate([p, v, np.ravel(a)])
+
+    return work
+
+
+def pure_loop(n):
+    dt, f, w = synthetic_imu(n)
+
+    def work():
+        p, v, a = POSITION, VELOCITY, ATTITUDE
+        for i in range(n):
+            g = pure_geodetic.gravitation_ecef(p)
+            p, v, a = pure_ecef.fwd_pva_S03(p, v, a, g, f[i], w[i], dt[i])
+        return np.concatenate([p, v, np.ravel(a)])
+
+    return work
+
+
+def py_loop(n):
+    dt, f, w = synthetic_imu(n)
+    fwd = pyennui.mechanization.ecef.fwd_pva_S03
+    grav = pyennui.geodetic.gravitation_ecef
+
+    def work():
+        p, v, a = POSITION.copy(), VELOCITY.copy(), ATTITUDE.copy()
+        pn, vn, an = np.zeros(3), np.zeros(3), np.zeros((3, 3))
+        for i in range(n):
+            fwd(p, v, a, grav(p), f[i], w[i], dt[i], pn, vn, an)
+            p, pn = pn, p
+            v, vn = vn, v
+            a, an = an, a
+        return np.concatenate([p, v, np.ravel(a)])
+
+    return work
+
+
+def py_batch(n):
+    dt, f, w = synthetic_imu(n)
+
+    def work():
+        p, v, a = pyennui.mechanization.ecef.propagate_batch(
+            POSITION, VELOCITY, ATTITUDE, dt, f, w
+        )
+        return np.concatenate([p[-1], v[-1], a[-1]])
+
+    return work
+
+
+def pure_rotation_loop(n):
+    x = synthetic_imu(n)[2]
+    return lambda: np.stack([pure_rotation.R3_to_SO3(xi) for xi in x])
+
+
+def py_rotation_loop(n):
+    x = synthetic_imu(n)[2]
+    return lambda: np.stack([pyennui.math.R3_to_SO3(xi) for xi in x])
+
+
+def pure_gravitation_loop(n):
+    x = pure_geodetic_to_ecef(synthetic_llh(n))
+    return lambda: np.stack([pure_geodetic.gravitation_ecef(xi) for xi in x])
+
+
+def py_gravitation_loop(n):
+    x = pure_geodetic_to_ecef(synthetic_llh(n))
+    return lambda: np.stack([pyennui.geodetic.gravitation_ecef(xi) for xi in x])
+
+
+def py_gravitation_batch(n):
+    x = pure_geodetic_to_ecef(synthetic_llh(n))
+    return lambda: pyennui.geodetic.gravitation_ecef_batch(x)
+
+
+def pure_geodetic_batch(n):
+    llh = synthetic_llh(n)
+    return lambda: pure_geodetic_to_ecef(llh)
+
+
+def py_geodetic_batch(n):
+    llh = synthetic_llh(n)
+    return lambda: pyennui.geodetic.position_geodetic_to_ecef_batch(llh)
+
+
+def cases(n):
+    """(case, pattern, calls per run, pure_ennui factory, pyennui factory)"""
+    return [
+        ("fwd_pva_S03", "single", 1, pure_step, py_step),
+        ("propagate", "loop", n, lambda: pure_loop(n), lambda: py_loop(n)),
+        ("propagate", "batch", n, lambda: pure_loop(n), lambda: py_batch(n)),
+        (
+            "R3_to_SO3",
+            "loop",
+            n,
+            lambda: pure_rotation_loop(n),
+            lambda: py_rotation_loop(n),
+        ),
+        (
+            "gravitation_ecef",
+            "loop",
+            n,
+            lambda: pure_gravitation_loop(n),
+            lambda: py_gravitation_loop(n),
+        ),
+        (
+            "gravitation_ecef",
+            "batch",
+            n,
+            lambda: pure_gravitation_loop(n),
+            lambda: py_gravitation_batch(n),
+        ),
+        (
+            "geodetic_to_ecef",
+            "batch",
+            n,
+            lambda: pure_geodetic_batch(n),
+            lambda: py_geodetic_batch(n),
+        ),
+    ]
+
+
+# ---------------------------------------------------------------------------
+
+
+def time_per_call(work, calls, repeat, min_time):
+    """Best and median seconds per call over `repeat` runs"""
+    timer = timeit.Timer(work)
+    number, _ = timer.autorange()
+    number = max(1, int(number * max(min_time / 0.2, 1.0)))
+    runs = np.array(timer.repeat(repeat=repeat, number=number)) / (number * calls)
+    return float(runs.min()), float(np.median(runs))
+
+
+def agreement(x, y):
+    """Max absolute and relative differences"""
+    x = np.ravel(np.asarray(x, dtype=float))
+    y = np.ravel(np.asarray(y, dtype=float))
+    diff = np.abs(x - y)
+    scale = np.maximum(np.abs(x), np.abs(y))
+    rel = np.divide(diff, scale, out=np.zeros_like(diff), where=scale > 0)
+    return float(diff.max()), float(rel.max())
+
+
+def run(n, repeat, min_time):
+    results = []
+    for name, pattern, calls, pure_factory, py_factory in cases(n):
+        row = {"case": name, "pattern": pattern, "n": calls}
+        outputs = {}
+        for impl, factory, ok in (
+            ("pure_ennui", pure_factory, pure_ennui_available),
+            ("pyennui", py_factory, pyennui is not None),
+        ):
+            if not ok:
+                continue
+            work = factory()
+            outputs[impl] = work()
+            best, median = time_per_call(work, calls, repeat, min_time)
+            row[impl] = {"best_s": best, "median_s": median}
+        if len(outputs) == 2:
+            row["max_abs_diff"], row["max_rel_diff"] = agreement(
+                outputs["pure_ennui"], outputs["pyennui"]
+            )
+            row["speedup"] = row["pure_ennui"]["best_s"] / row["pyennui"]["best_s"]
+        results.append(row)
+        print(format_row(row), flush=True)
+    return results
+
+
+def environment():
+    env = {
+        "python": platform.python_version(),
+        "numpy": np.__version__,
+        "machine": platform.machine(),
+        "processor": platform.processor(),
+        "system": platform.platform(),
+        "pyennui": pyennui is not None,
+        "pure_ennui": pure_ennui_available,
+    }
+    if pyennui is not None and hasattr(pyennui, "kernels"):
+        env["pyennui_isa"] = pyennui.kernels.active_isa()
+    return env
+
+
+def fmt_time(row, impl):
+    return "%11.3e" % row[impl]["best_s"] if impl in row else "%11s" % "-"
+
+
+def format_row(row):
+    speedup = "%8.1fx" % row["speedup"] if "speedup" in row else "%9s" % "-"
+    rel = "%9.1e" % row["max_rel_diff"] if "max_rel_diff" in row else "%9s" % "-"
+    return "| %-16s | %-7s | %7d | %s | %s | %s | %s |" % (
+        row["case"],
+        row["pattern"],
+        row["n"],
+        fmt_time(row, "pure_ennui"),
+        fmt_time(row, "pyennui"),
+        speedup,
+        rel,
+    )
+
+
+HEADER = (
+    "| case             | pattern |       n |    pure [s] | pyennui [s]"
+    " |   speedup | rel. diff |\n"
+    "|------------------|---------|---------|-------------|------------"
+    "-|-----------|-----------|"
+)
+
+
+def markdown(report):
+    lines = ["# ennui Python benchmark", ""]
+    lines += ["- %s: %s" % kv for kv in sorted(report["environment"].items())]
+    lines += ["", "Seconds per call (best of repeats).", "", HEADER]
+    lines += [format_row(row) for row in report["results"]]
+    return "\n".join(lines) + "\n"
+
+
+def compare(report, previous):
+    """Print this/previous time ratio for each case and implementation"""
+    old = {(r["case"], r["pattern"]): r for r in previous["results"]}
+    print("\nRelative to previous report (>1 is slower):")
+    for row in report["results"]:
+        prev = old.get((row["case"], row["pattern"]))
+        if prev is None:
+            continue
+        for impl in ("pure_ennui", "pyennui"):
+            if impl in row and impl in prev:
+                print(
+                    "  %-16s %-7s %-10s %6.2f"
+                    % (
+                        row["case"],
+                        row["pattern"],
+                        impl,
+                        row[impl]["best_s"] / prev[impl]["best_s"],
+                    )
+                )
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-n", type=int, default=1000, help="samples per loop/batch")
+    parser.add_argument("--repeat", type=int, default=5, help="timing repeats")
+    parser.add_argument(
+        "--min-time", type=float, default=0.2, help="seconds per timing repeat"
+    )
+    parser.add_argument("--json", help="write JSON report")
+    parser.add_argument("--markdown", help="write Markdown report")
+    parser.add_argument("--compare", help="previous JSON report")
+    args = parser.parse_args(argv)
+
+    if not (pure_ennui_available or pyennui):
+        parser.error("neither pyennui nor pure_ennui can be imported")
+
+    print(HEADER)
+    report = {
+        "environment": environment(),
+        "results": run(args.n, args.repeat, args.min_time),
+    }
+    if args.json:
+        with open(args.json, "w") as fh:
+            json.dump(report, fh, indent=2)
+    if args.markdown:
+        with open(args.markdown, "w") as fh:
+            fh.write(markdown(report))
+    if args.compare:
+        with open(args.compare) as fh:
+            compare(report, json.load(fh))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,7 +1,15 @@
 #include <nanobind/eigen/dense.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/tuple.h>
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include "ecef.hpp"
 #include "gravitation.hpp"
+#include "kernels.hpp"
 #include "rotation.hpp"
 #include "wgs84.hpp"
 
@@ -13,19 +21,133 @@ void normalize_SO3_return_arg(const Eigen::Ref<const ennui::Matrix3x3> &m,
 namespace nb = nanobind;
 using ennui::geodetic::Wgs84;
 
+// Batched arguments: one row per sample, rows contiguous
+typedef Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> ArrayNx3;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 9, Eigen::RowMajor> ArrayNx9;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1> ArrayN;
+typedef Eigen::Map<const Eigen::Matrix<double, 1, 9>> ConstMapRow9;
+
+// Contiguous rows of a batched argument, copied only if the array is strided
+const double *rows_of(const Eigen::Ref<const ArrayNx3> &a, ArrayNx3 &storage) {
+  if (a.outerStride() == 3) return a.data();
+  storage = a;
+  return storage.data();
+}
+
+// Hot paths are routed through the precompiled kernels, which select the best
+// instruction set for the host at load time.
+ennui::Vector3 gravitation_ecef(ennui::ConstRefVector3 &position) {
+  return ennui::kernels::gravitation_ecef(position);
+}
+
+ennui::Matrix3x3 R3_to_SO3(ennui::ConstRefVector3 &x) {
+  return ennui::kernels::R3_to_SO3(x);
+}
+
+void fwd_pva_S03(ennui::ConstRefVector3 &position_minus,
+                 ennui::ConstRefVector3 &velocity_minus,
+                 const Eigen::Ref<const ennui::Matrix3x3> &attitude_minus,
+                 ennui::ConstRefVector3 &gravitation,
+                 ennui::ConstRefVector3 &specific_force,
+                 ennui::ConstRefVector3 &angular_rate, double dt,
+                 ennui::RefVector3 position_plus,
+                 ennui::RefVector3 velocity_plus,
+                 Eigen::Ref<ennui::Matrix3x3> attitude_plus) {
+  ennui::Vector3 position, velocity;
+  ennui::Matrix3x3 attitude;
+  ennui::kernels::fwd_pva_S03(position_minus, velocity_minus, attitude_minus,
+                              gravitation, specific_force, angular_rate, dt,
+                              position, velocity, attitude);
+  position_plus = position;
+  velocity_plus = velocity;
+  attitude_plus = attitude;
+}
+
+ArrayNx3 gravitation_ecef_batch(const Eigen::Ref<const ArrayNx3> &positions) {
+  ArrayNx3 storage, rslt(positions.rows(), 3);
+  ennui::kernels::gravitation_ecef(rows_of(positions, storage), rslt.data(),
+                                   positions.rows());
+  return rslt;
+}
+
+ArrayNx3 position_geodetic_to_ecef_batch(
+    const Eigen::Ref<const ArrayNx3> &positions_llh) {
+  ArrayNx3 storage, rslt(positions_llh.rows(), 3);
+  ennui::kernels::position_geodetic_to_ecef(rows_of(positions_llh, storage),
+                                            rslt.data(), positions_llh.rows());
+  return rslt;
+}
+
+// Propagate through N samples; returns positions (Nx3), velocities (Nx3) and
+// attitudes (Nx9, each row a 3x3 matrix in the module's storage order)
+std::tuple<ArrayNx3, ArrayNx3, ArrayNx9> propagate_batch(
+    ennui::ConstRefVector3 &position, ennui::ConstRefVector3 &velocity,
+    const Eigen::Ref<const ennui::Matrix3x3> &attitude,
+    const Eigen::Ref<const ArrayN> &dt,
+    const Eigen::Ref<const ArrayNx3> &specific_force,
+    const Eigen::Ref<const ArrayNx3> &angular_rate) {
+  const Eigen::Index n = dt.rows();
+  if (specific_force.rows() != n || angular_rate.rows() != n) {
+    throw std::invalid_argument("propagate_batch: mismatched sample counts");
+  }
+  std::vector<ennui::ImuSample> samples(n);
+  double time = 0.0;
+  for (Eigen::Index i = 0; i < n; ++i) {
+    time += dt[i];
+    samples[i] = ennui::ImuSample{time, dt[i],
+                                  specific_force.row(i).transpose(),
+                                  angular_rate.row(i).transpose()};
+  }
+  ennui::StatePvaSO3 state{0.0, position, velocity, attitude};
+  std::vector<ennui::StatePvaSO3> history(n);
+  ennui::kernels::propagate(state, samples.data(), samples.size(),
+                            history.data());
+
+  ArrayNx3 positions(n, 3), velocities(n, 3);
+  ArrayNx9 attitudes(n, 9);
+  for (Eigen::Index i = 0; i < n; ++i) {
+    positions.row(i) = history[i].position.transpose();
+    velocities.row(i) = history[i].velocity.transpose();
+    attitudes.row(i) = ConstMapRow9(history[i].attitude.data());
+  }
+  return std::make_tuple(positions, velocities, attitudes);
+}
+
+void select_isa(const std::string &name) {
+  ennui::kernels::Isa isa;
+  if (!ennui::kernels::parse_isa(name.c_str(), isa)) {
+    throw std::invalid_argument("unknown instruction set: " + name);
+  }
+  ennui::kernels::select_isa(isa);
+}
+
 NB_MODULE(pyennui, m) {
   auto m_math = m.def_submodule("math");
   m_math.def("normalize_SO3", &ennui::math::normalize_SO3);
   m_math.def("normalize_SO3_Groves", &ennui::math::normalize_SO3_Groves);
   m_math.def("R3_to_so3", &ennui::math::R3_to_so3);
-  m_math.def("R3_to_SO3", &ennui::math::R3_to_SO3);
+  m_math.def("R3_to_SO3", &R3_to_SO3);
 
   auto m_geodetic = m.def_submodule("geodetic");
-  m_geodetic.def("gravitation_ecef", &ennui::geodetic::gravitation_ecef<Wgs84>);
+  m_geodetic.def("gravitation_ecef", &gravitation_ecef);
+  m_geodetic.def("gravitation_ecef_batch", &gravitation_ecef_batch);
+  m_geodetic.def("position_geodetic_to_ecef_batch",
+                 &position_geodetic_to_ecef_batch);
 
   auto m_mechanization = m.def_submodule("mechanization");
   auto m_ecef = m_mechanization.def_submodule("ecef");
-  m_ecef.def("fwd_pva_S03", &ennui::mechanization::ecef::fwd_pva_S03<Wgs84>);
+  m_ecef.def("fwd_pva_S03", &fwd_pva_S03);
+  m_ecef.def("propagate_batch", &propagate_batch);
+
+  auto m_kernels = m.def_submodule("kernels");
+  m_kernels.def("active_isa", []() {
+    return std::string(ennui::kernels::isa_name(ennui::kernels::active_isa()));
+  });
+  m_kernels.def("detected_isa", []() {
+    return std::string(
+        ennui::kernels::isa_name(ennui::kernels::detected_isa()));
+  });
+  m_kernels.def("select_isa", &select_isa);
 
   m.def("normalize_SO3_return_arg", &normalize_SO3_return_arg);
 };
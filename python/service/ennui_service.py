@@ -0,0 +1,231 @@
+"""Thin client of the local ennui propagation daemon (ennuid)
+
+Batches are written into a POSIX shared-memory segment owned by the client;
+only fixed-size control messages cross the daemon's Unix socket. Results are
+returned as NumPy views of the segment (no copy), valid until the next call on
+the same client - copy them to keep them. The wire format is documented in
+Ennui/service/service_protocol.hpp.
+
+Requires the standard library and NumPy only.
+
+    with ServiceClient() as client:
+        p, v, a = client.propagate_batch(position, velocity, attitude, dt, f, w)
+
+Run as a script to benchmark the daemon against in-process pyennui calls:
+
+    python python/service/ennui_service.py --bench
+"""
+
+import argparse
+import os
+import socket
+import struct
+import time
+import uuid
+from multiprocessing import shared_memory
+
+import numpy as np
+
+PROTOCOL_MAGIC = 0x56534E45
+SEGMENT_NAME_SIZE = 64
+IMU_RECORD, STATE_RECORD, VECTOR_RECORD = 8, 16, 3
+
+OP_ATTACH, OP_PROPAGATE, OP_GRAVITATION_ECEF, OP_GEODETIC_TO_ECEF = 1, 2, 3, 4
+STATUS = {
+    0: "OK",
+    -1: "BAD_REQUEST",
+    -2: "NOT_ATTACHED",
+    -3: "OUT_OF_RANGE",
+    -4: "ATTACH_FAILED",
+    -5: "UNAVAILABLE",
+    -6: "CONNECTION_FAILED",
+}
+
+# Request: magic, op, count, input offset, output offset, segment name
+REQUEST = struct.Struct("<IIQQQ%ds" % SEGMENT_NAME_SIZE)
+# Response: magic, status, count, seconds
+RESPONSE = struct.Struct("<IiQd")
+
+
+def default_socket_path():
+    """Default socket of ennuid"""
+    runtime = os.environ.get("XDG_RUNTIME_DIR")
+    if runtime:
+        return os.path.join(runtime, "ennui.sock")
+    return "/tmp/ennui-%d.sock" % os.getuid()
+
+
+class ServiceError(RuntimeError):
+    """Request rejected by the daemon"""
+
+
+class ServiceClient:
+    """Connection to ennuid with its own shared-memory segment"""
+
+    def __init__(self, socket_path=None, segment_bytes=64 << 20):
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(socket_path or default_socket_path())
+        name = "ennui-py-%d-%s" % (os.getpid(), uuid.uuid4().hex[:8])
+        self._shm = shared_memory.SharedMemory(
+            name=name, create=True, size=segment_bytes
+        )
+        try:
+            # The daemon maps the segment by name; the name is not needed after
+            self._exchange(OP_ATTACH, segment_bytes, 0, 0, ("/" + name).encode())
+        finally:
+            self._shm.unlink()
+        #: Whole segment as float64
+        self.segment = np.ndarray(
+            (segment_bytes // 8,), dtype=np.float64, buffer=self._shm.buf
+        )
+
+    def close(self):
+        """Disconnect; views of the segment must have been released"""
+        self.segment = None
+        self._socket.close()
+        self._shm.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _exchange(self, op, count, input_offset, output_offset, segment=b""):
+        self._socket.sendall(
+            REQUEST.pack(
+                PROTOCOL_MAGIC, op, count, input_offset, output_offset, segment
+            )
+        )
+        data = b""
+        while len(data) < RESPONSE.size:
+            chunk = self._socket.recv(RESPONSE.size - len(data))
+            if not chunk:
+                raise ConnectionError("ennuid closed the connection")
+            data += chunk
+        magic, status, count, seconds = RESPONSE.unpack(data)
+        if magic != PROTOCOL_MAGIC or status != 0:
+            raise ServiceError(STATUS.get(status, "malformed response"))
+        return count, seconds
+
+    def call(self, op, count, input_offset, output_offset):
+        """One request on records already in the segment (byte offsets)"""
+        return self._exchange(op, count, input_offset, output_offset)
+
+    def _room(self, doubles):
+        if doubles > self.segment.size:
+            raise ValueError("batch larger than the segment")
+
+    def propagate_batch(
+        self, position, velocity, attitude, dt, specific_force, angular_rate
+    ):
+        """As pyennui.mechanization.ecef.propagate_batch; returns segment views"""
+        dt = np.asarray(dt, dtype=np.float64)
+        n = dt.shape[0]
+        output = STATE_RECORD + IMU_RECORD * n
+        self._room(output + STATE_RECORD * n)
+        initial = self.segment[:STATE_RECORD]
+        initial[0] = 0.0
+        initial[1:4] = position
+        initial[4:7] = velocity
+        initial[7:16] = np.asarray(attitude, dtype=np.float64).reshape(9)
+        imu = self.segment[STATE_RECORD:output].reshape(n, IMU_RECORD)
+        imu[:, 0] = np.cumsum(dt)
+        imu[:, 1] = dt
+        imu[:, 2:5] = specific_force
+        imu[:, 5:8] = angular_rate
+        self._exchange(OP_PROPAGATE, n, 0, 8 * output)
+        end = output + STATE_RECORD * n
+        states = self.segment[output:end].reshape(n, STATE_RECORD)
+        return states[:, 1:4], states[:, 4:7], states[:, 7:16]
+
+    def _vector_op(self, op, values):
+        values = np.asarray(values, dtype=np.float64).reshape(-1, VECTOR_RECORD)
+        n = values.shape[0]
+        size = VECTOR_RECORD * n
+        self._room(2 * size)
+        self.segment[:size] = values.reshape(-1)
+        self._exchange(op, n, 0, 8 * size)
+        end = 2 * size
+        return self.segment[size:end].reshape(n, VECTOR_RECORD)
+
+    def gravitation_ecef_batch(self, positions):
+        """As pyennui.geodetic.gravitation_ecef_batch; returns a segment view"""
+        return self._vector_op(OP_GRAVITATION_ECEF, positions)
+
+    def position_geodetic_to_ecef_batch(self, positions_llh):
+        """As pyennui.geodetic.position_geodetic_to_ecef_batch; returns a view"""
+        return self._vector_op(OP_GEODETIC_TO_ECEF, positions_llh)
+
+
+# White House landmark, see tests/common/landmarks.cpp
+POSITION = np.array([1.115042345294169e06, -4.843812298149152e06, 3.983520216446271e06])
+VELOCITY = np.array([1.700252783993267e00, 5.799253612971604e00, -7.143100966293305e00])
+ATTITUDE = np.array(
+    [
+        [-1.689390579588263e-01, -4.453768089569571e-01, -8.792605374627603e-01],
+        [8.000355898459490e-01, -5.830041132072308e-01, 1.415954058693114e-01],
+        [-5.756758199506289e-01, -6.795187282384265e-01, 4.548094637289362e-01],
+    ]
+)
+
+
+def _per_call(work, min_time=0.2):
+    calls, start = 0, time.perf_counter()
+    while True:
+        work()
+        calls += 1
+        elapsed = time.perf_counter() - start
+        if elapsed >= min_time:
+            return elapsed / calls
+
+
+def bench(socket_path, sizes):
+    """Per-call time of propagate_batch through the daemon and in-process"""
+    try:
+        import pyennui
+    except ImportError:
+        pyennui = None
+    with ServiceClient(socket_path) as client:
+        print(
+            "%8s %14s %14s %12s" % ("batch", "service [us]", "pyennui [us]", "max diff")
+        )
+        for n in sizes:
+            t = 1e-2 * np.arange(n)
+            dt = np.full(n, 1e-2)
+            f = np.column_stack(
+                [0.2 * np.sin(t), 0.1 * np.cos(0.5 * t), np.full(n, 9.81)]
+            )
+            w = np.column_stack(
+                [0.01 * np.cos(t), np.full(n, -0.02), 0.03 * np.sin(0.2 * t)]
+            )
+            args = (POSITION, VELOCITY, ATTITUDE, dt, f, w)
+            remote = _per_call(lambda: client.propagate_batch(*args))
+            local, diff = float("nan"), float("nan")
+            if pyennui is not None:
+                propagate = pyennui.mechanization.ecef.propagate_batch
+                local = _per_call(lambda: propagate(*args))
+                diff = np.max(
+                    np.abs(client.propagate_batch(*args)[0] - propagate(*args)[0])
+                )
+            print("%8d %14.1f %14.1f %12.3g" % (n, 1e6 * remote, 1e6 * local, diff))
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--socket", default=None, help="ennuid socket path")
+    parser.add_argument(
+        "--bench", action="store_true", help="benchmark against pyennui"
+    )
+    parser.add_argument(
+        "--sizes", type=int, nargs="+", default=[1, 16, 256, 4096, 65536]
+    )
+    args = parser.parse_args(argv)
+    if args.bench:
+        bench(args.socket, args.sizes)
+    else:
+        parser.print_help()
+
+
+if __name__ == "__main__":
+    main()
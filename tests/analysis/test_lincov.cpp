@@ -0,0 +1,160 @@
+#include <vector>
+
+#include "gravitation.hpp"
+#include "lincov.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::analysis::AidingUpdate;
+using ennui::analysis::block_sigma;
+using ennui::analysis::ImuErrorModel;
+using ennui::analysis::InitialUncertainty;
+using ennui::analysis::LinCov;
+using ennui::analysis::LinCovConfig;
+using ennui::analysis::LinCovEpoch;
+using ennui::analysis::Matrix15x15;
+using ennui::analysis::POSITION_ERROR;
+using ennui::analysis::VELOCITY_ERROR;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+
+//! Near-level flight at 100 Hz: specific force balancing gravitation
+static std::vector<ImuSample> cruise(double duration) {
+  const double dt = 0.01;
+  const StatePvaSO3 s = landmark_start_state();
+  const Vector3 f =
+      -(s.attitude.transpose() * gravitation_ecef<Wgs84>(s.position));
+  std::vector<ImuSample> samples;
+  for (std::size_t k = 0; k * dt < duration - 1e-9; ++k) {
+    const double t = k * dt;
+    samples.push_back(ImuSample{t + dt, dt, f + Vector3{0.1 * sin(t), 0, 0},
+                                Vector3{0, 0, 1e-3 * cos(0.1 * t)}});
+  }
+  return samples;
+}
+
+//! Dense exp by many Taylor terms, for reference
+static Matrix15x15 expm_dense(const Matrix15x15 &A) {
+  Matrix15x15 X = A / 1024.0, result = Matrix15x15::Identity(), term = X;
+  for (int k = 1; k < 30; ++k) {
+    result += term;
+    term = term * X / (k + 1);
+  }
+  for (int s = 0; s < 10; ++s) result = result * result;
+  return result;
+}
+
+//! Block-sparse exponential agrees with a dense series
+TEST_CASE("lincov expm", "[analysis][lincov]") {
+  Matrix15x15 A = Matrix15x15::Zero();
+  unsigned mask = 0;
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      if ((i + 2 * j) % 3 == 0) {
+        A.block<3, 3>(3 * i, 3 * j) = Matrix15x15::Random().block<3, 3>(0, 0);
+        mask |= ennui::analysis::detail::block_bit(i, j);
+      }
+    }
+  }
+  const Matrix15x15 expected = expm_dense(3.0 * A);
+  const Matrix15x15 actual =
+      ennui::analysis::detail::expm_block_sparse(3.0 * A, mask);
+  REQUIRE((actual - expected).norm() < 1e-10 * expected.norm());
+}
+
+//! Free-inertial growth from single sources matches closed forms
+TEST_CASE("lincov free inertial", "[analysis][lincov]") {
+  const std::vector<ImuSample> samples = cruise(20.0);
+  const double T = 20.0;
+
+  InitialUncertainty initial;
+  initial.velocity_sigma = 0.1;
+  ImuErrorModel imu;
+  imu.accel_bias_sigma = 1e-3;
+  imu.accel_noise_density = 1e-3;
+  LinCov<Wgs84> lincov(landmark_start_state(), initial, imu);
+  lincov.run(samples.data(), samples.size());
+  lincov.flush();
+
+  const LinCovEpoch &end = lincov.history().back();
+  REQUIRE(fabs(end.time - T) < 1e-9);
+  REQUIRE(lincov.history().size() == 21);
+  // Each source alone: per-axis position sigma
+  const double from_velocity = block_sigma(end.budget[1], POSITION_ERROR);
+  const double from_bias = block_sigma(end.budget[3], POSITION_ERROR);
+  const double from_noise = block_sigma(end.budget[5], POSITION_ERROR);
+  PRINT_txt("position sigma after " << T << " s: initial velocity "
+                                    << from_velocity << ", accel bias "
+                                    << from_bias << ", accel noise "
+                                    << from_noise);
+  REQUIRE(fabs(from_velocity - sqrt(3.0) * 0.1 * T) < 1e-3 * from_velocity);
+  REQUIRE(fabs(from_bias - sqrt(3.0) * 0.5e-3 * T * T) < 1e-3 * from_bias);
+  REQUIRE(fabs(from_noise - sqrt(3.0 * 1e-6 * T * T * T / 3)) <
+          1e-2 * from_noise);
+  REQUIRE(block_sigma(end.budget[0], POSITION_ERROR) == 0);
+}
+
+//! Budgets sum to the total, through propagation and updates
+TEST_CASE("lincov budget", "[analysis][lincov]") {
+  const std::vector<ImuSample> samples = cruise(60.0);
+  InitialUncertainty initial;
+  initial.position_sigma = 10;
+  initial.velocity_sigma = 0.5;
+  initial.attitude_sigma = 1e-3;
+  ImuErrorModel imu;
+  imu.accel_bias_sigma = 5e-3;
+  imu.accel_bias_tau = 300;
+  imu.gyro_bias_sigma = 1e-5;
+  imu.accel_noise_density = 1e-3;
+  imu.gyro_noise_density = 1e-5;
+  LinCov<Wgs84> lincov(landmark_start_state(), initial, imu);
+  for (int k = 1; k <= 6; ++k) {
+    lincov.add_update(
+        AidingUpdate::position_fix(10.0 * k - 0.005, 2.0, "gnss"));
+  }
+  lincov.add_update(AidingUpdate::velocity_fix(30.0, 0.05));
+  lincov.run(samples.data(), samples.size());
+  lincov.flush();
+
+  REQUIRE(lincov.sources().size() == 9);
+  REQUIRE(lincov.sources()[7] == "gnss");
+  for (const LinCovEpoch &epoch : lincov.history()) {
+    ennui::analysis::Vector15 sum = ennui::analysis::Vector15::Zero();
+    for (const ennui::analysis::Vector15 &b : epoch.budget) sum += b;
+    REQUIRE((sum - epoch.variance).norm() <= 1e-9 * epoch.variance.norm());
+    REQUIRE(epoch.variance.minCoeff() >= 0);
+  }
+  // Position fixes bound the position error near the fix sigma
+  const double sigma = block_sigma(lincov.history().back().variance,
+                                   POSITION_ERROR);
+  PRINT_txt("position sigma with 2 m fixes every 10 s: " << sigma);
+  REQUIRE(sigma < sqrt(3.0) * 2.0);
+  REQUIRE(block_sigma(lincov.history().back().budget[7], POSITION_ERROR) > 0);
+}
+
+//! Covariance does not depend on the propagation rate
+TEST_CASE("lincov rate", "[analysis][lincov]") {
+  const std::vector<ImuSample> samples = cruise(30.0);
+  InitialUncertainty initial;
+  initial.attitude_sigma = 1e-3;
+  ImuErrorModel imu;
+  imu.gyro_bias_sigma = 1e-5;
+  imu.gyro_noise_density = 1e-5;
+
+  LinCovConfig coarse, fine;
+  coarse.dt = 1.0;
+  fine.dt = 0.05;
+  LinCov<Wgs84> a(landmark_start_state(), initial, imu, coarse);
+  LinCov<Wgs84> b(landmark_start_state(), initial, imu, fine);
+  a.run(samples.data(), samples.size());
+  b.run(samples.data(), samples.size());
+  const Matrix15x15 Pa = a.covariance(), Pb = b.covariance();
+  PRINT_txt("velocity sigma, 1 s vs 0.05 s propagation: "
+            << block_sigma(Pa.diagonal(), VELOCITY_ERROR) << " vs "
+            << block_sigma(Pb.diagonal(), VELOCITY_ERROR));
+  REQUIRE((Pa - Pb).norm() < 1e-3 * Pb.norm());
+}
@@ -0,0 +1,37 @@
+/**
+ * @file synthetic_imu.hpp
+ * @brief Landmark start state and synthetic IMU log shared across tests.
+ */
+
+#pragma once
+#include <math.h>
+
+#include <vector>
+
+#include "ennui_types.hpp"
+#include "landmarks.hpp"
+
+//! White House prior at time zero
+inline ennui::StatePvaSO3 landmark_start_state() {
+  const state_pva_SO3 &p = WhiteHouse_mean_prop.prior;
+  return ennui::StatePvaSO3{0.0, p.position, p.velocity, p.attitude};
+}
+
+//! Sample k of a smooth log near 1 g with slowly varying body rates
+inline ennui::ImuSample synthetic_imu_sample(std::size_t k, double dt) {
+  const double t = k * dt;
+  return ennui::ImuSample{
+      t + dt, dt, ennui::Vector3{0.5 * sin(t), 1.0 * cos(0.3 * t), 9.8},
+      ennui::Vector3{0.2 * cos(t), -0.1, 0.3 * sin(0.5 * t)}};
+}
+
+//! The first count samples of synthetic_imu_sample
+inline std::vector<ennui::ImuSample> synthetic_imu_samples(std::size_t count,
+                                                           double dt) {
+  std::vector<ennui::ImuSample> samples;
+  samples.reserve(count);
+  for (std::size_t k = 0; k < count; ++k) {
+    samples.push_back(synthetic_imu_sample(k, dt));
+  }
+  return samples;
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <vector>
+
+#include "frame_transform.hpp"
+#include "landmarks.hpp"
+#include "local_frame.hpp"
+#include "rotation.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::Matrix3x3;
+using ennui::Vector3;
+using ennui::geodetic::LocalAxes;
+using ennui::geodetic::LocalFrame;
+using ennui::geodetic::position_geodetic_to_ecef;
+using ennui::geodetic::Wgs84;
+
+//! Axes point east, north and up (or north, east, down) at the origin
+TEST_CASE("local frame axes", "[geodetic][local]") {
+  for (const Vector3 &llh :
+       {WhiteHouse_LLH, SydneyOpera_LLH, AconcaguaPeak_LLH}) {
+    const LocalFrame<Wgs84> enu(llh);
+    const LocalFrame<Wgs84> ned(llh, LocalAxes::NED);
+    REQUIRE((enu.origin_ecef() - position_geodetic_to_ecef<Wgs84>(llh))
+                .norm() == 0);
+    REQUIRE((enu.rotation() * enu.rotation().transpose() -
+             Matrix3x3::Identity())
+                .norm() < 1e-15);
+    REQUIRE(enu.rotation().determinant() > 0);
+    REQUIRE(ned.rotation().determinant() > 0);
+    REQUIRE(enu.position_from_ecef(enu.origin_ecef()).norm() == 0);
+
+    // Up is the ellipsoid normal: height is exactly the third component
+    const Vector3 above =
+        position_geodetic_to_ecef<Wgs84>(llh + Vector3{0, 0, 100});
+    REQUIRE((enu.position_from_ecef(above) - Vector3{0, 0, 100}).norm() <
+            1e-8);
+    REQUIRE((ned.position_from_ecef(above) - Vector3{0, 0, -100}).norm() <
+            1e-8);
+
+    // Small steps in latitude and longitude move north and east
+    const Vector3 north =
+        enu.position_from_ecef(position_geodetic_to_ecef<Wgs84>(
+            llh + Vector3{1e-5, 0, 0}));
+    const Vector3 east = enu.position_from_ecef(
+        position_geodetic_to_ecef<Wgs84>(llh + Vector3{0, 1e-5, 0}));
+    REQUIRE(north[1] > 1.0);
+    REQUIRE(fabs(north[0]) < 1e-6);
+    REQUIRE(east[0] > 0.5);
+    REQUIRE(fabs(east[1]) < 1e-3);
+    REQUIRE((ned.position_from_ecef(position_geodetic_to_ecef<Wgs84>(
+                 llh + Vector3{1e-5, 0, 0})) -
+             Vector3{north[1], north[0], -north[2]})
+                .norm() < 1e-9);
+  }
+}
+
+//! Conversions invert each other, single and batched
+TEST_CASE("local frame round trip", "[geodetic][local]") {
+  const LocalFrame<Wgs84> frame(WhiteHouse_LLH, LocalAxes::NED);
+  const state_pva_SO3 &s = WhiteHouse_mean_prop.posterior;
+
+  const Vector3 p = frame.position_from_ecef(s.position);
+  const Vector3 v = frame.velocity_from_ecef(s.velocity);
+  const Matrix3x3 A = frame.attitude_from_ecef(s.attitude);
+  REQUIRE((frame.position_to_ecef(p) - s.position).norm() < 1e-8);
+  REQUIRE((frame.velocity_to_ecef(v) - s.velocity).norm() < 1e-14);
+  REQUIRE((frame.attitude_to_ecef(A) - s.attitude).norm() < 1e-14);
+  REQUIRE(fabs(v.norm() - s.velocity.norm()) < 1e-14);
+
+  // Batched variants match single conversions, also in place
+  const std::size_t n = 64;
+  std::vector<double> positions(3 * n), attitudes(9 * n);
+  for (std::size_t i = 0; i < n; ++i) {
+    ennui::MapVector3 position(&positions[3 * i]);
+    ennui::MapMatrix3x3 attitude(&attitudes[9 * i]);
+    position = s.position + Vector3{1.0 * i, -2.0 * i, 0.5 * i};
+    attitude = s.attitude * ennui::math::R3_to_SO3(Vector3{0.01 * i, 0, 0.02});
+  }
+  std::vector<double> local(3 * n);
+  frame.position_from_ecef(positions.data(), local.data(), n);
+  std::vector<double> attitudes_local = attitudes;
+  frame.attitude_from_ecef(attitudes_local.data(), attitudes_local.data(), n);
+  for (std::size_t i = 0; i < n; ++i) {
+    REQUIRE((ennui::MapVector3(&local[3 * i]) -
+             frame.position_from_ecef(ennui::MapVector3(&positions[3 * i])))
+                .norm() == 0);
+    REQUIRE((ennui::MapMatrix3x3(&attitudes_local[9 * i]) -
+             frame.attitude_from_ecef(ennui::MapMatrix3x3(&attitudes[9 * i])))
+                .norm() == 0);
+  }
+  frame.position_to_ecef(local.data(), local.data(), n);
+  frame.attitude_to_ecef(attitudes_local.data(), attitudes_local.data(), n);
+  for (std::size_t i = 0; i < 3 * n; ++i) {
+    REQUIRE(fabs(local[i] - positions[i]) < 1e-8);
+  }
+  for (std::size_t i = 0; i < 9 * n; ++i) {
+    REQUIRE(fabs(attitudes_local[i] - attitudes[i]) < 1e-14);
+  }
+
+  std::vector<double> velocities(positions), out(3 * n);
+  frame.velocity_from_ecef(velocities.data(), out.data(), n);
+  frame.velocity_to_ecef(out.data(), out.data(), n);
+  for (std::size_t i = 0; i < 3 * n; ++i) {
+    REQUIRE(fabs(out[i] - velocities[i]) < 1e-8);
+  }
+}
+
+//! Batched projection throughput
+TEST_CASE("local frame throughput", "[.][bench][geodetic]") {
+  const LocalFrame<Wgs84> frame(WhiteHouse_LLH);
+  const std::size_t n = 1 << 20;
+  std::vector<double> positions(3 * n), local(3 * n);
+  for (std::size_t i = 0; i < n; ++i) {
+    ennui::MapVector3 position(&positions[3 * i]);
+    position = WhiteHouse_ECEF + Vector3{1e-3 * i, 2e-3 * i, -1e-3 * i};
+  }
+  const auto t0 = std::chrono::steady_clock::now();
+  frame.position_from_ecef(positions.data(), local.data(), n);
+  const auto t1 = std::chrono::steady_clock::now();
+  std::cout << "ECEF to ENU: "
+            << n / std::chrono::duration<double>(t1 - t0).count()
+            << " points/s" << std::endl;
+}
@@ -0,0 +1,241 @@
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "landmarks.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "trajectory_file.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::io::TrajectoryEncoding;
+using ennui::io::TrajectoryReader;
+using ennui::io::TrajectoryWriter;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+
+//! Smooth trajectory from the White House landmark
+static std::vector<StatePvaSO3> trajectory(std::size_t n, double dt) {
+  std::vector<StatePvaSO3> states(1, landmark_start_state());
+  for (std::size_t k = 0; k + 1 < n; ++k) {
+    const ImuSample s = synthetic_imu_sample(k, dt);
+    StatePvaSO3 next;
+    fwd_pva_S03_rt<Wgs84>(states.back(),
+                          gravitation_ecef<Wgs84>(states.back().position), s,
+                          next);
+    states.push_back(next);
+  }
+  return states;
+}
+
+static std::string encode(const std::vector<StatePvaSO3> &states,
+                          const TrajectoryEncoding &encoding) {
+  std::stringstream file;
+  TrajectoryWriter writer(file, encoding);
+  for (const StatePvaSO3 &s : states) writer.write(s);
+  writer.close();
+  return file.str();
+}
+
+static std::vector<StatePvaSO3> decode(const std::string &bytes) {
+  std::istringstream file(bytes);
+  TrajectoryReader reader(file);
+  std::vector<StatePvaSO3> states;
+  StatePvaSO3 s;
+  while (reader.read(s)) states.push_back(s);
+  REQUIRE(states.size() == reader.records());
+  return states;
+}
+
+static bool identical(const StatePvaSO3 &a, const StatePvaSO3 &b) {
+  return a.time == b.time && a.position == b.position &&
+         a.velocity == b.velocity && a.attitude == b.attitude;
+}
+
+//! Lossless mode reproduces every bit, including landmark fixtures
+TEST_CASE("trajectory lossless", "[io][trajectory]") {
+  std::vector<StatePvaSO3> states = trajectory(1000, 0.01);
+  for (const prop_mean *landmark :
+       {&WhiteHouse_mean_prop, &SydneyOpera_mean_prop,
+        &AconcaguaPeak_mean_prop}) {
+    for (const state_pva_SO3 *s : {&landmark->prior, &landmark->posterior}) {
+      states.push_back(StatePvaSO3{landmark->dt, s->position, s->velocity,
+                                   s->attitude});
+    }
+  }
+
+  TrajectoryEncoding encoding;
+  encoding.mode = TrajectoryEncoding::LOSSLESS;
+  encoding.block_records = 256;
+  const std::string bytes = encode(states, encoding);
+  const std::vector<StatePvaSO3> decoded = decode(bytes);
+  REQUIRE(decoded.size() == states.size());
+  for (std::size_t k = 0; k < states.size(); ++k) {
+    REQUIRE(identical(decoded[k], states[k]));
+  }
+  PRINT_txt("lossless compression ratio "
+            << states.size() * 16 * 8.0 / bytes.size());
+}
+
+//! Quantized mode stays within its error bounds and is at least 5x smaller
+TEST_CASE("trajectory quantized", "[io][trajectory]") {
+  const std::vector<StatePvaSO3> states = trajectory(20000, 0.01);
+  const TrajectoryEncoding encoding;
+  const std::string bytes = encode(states, encoding);
+  const std::vector<StatePvaSO3> decoded = decode(bytes);
+  REQUIRE(decoded.size() == states.size());
+
+  double time = 0, position = 0, velocity = 0, attitude = 0;
+  for (std::size_t k = 0; k < states.size(); ++k) {
+    time = (std::max)(time, fabs(decoded[k].time - states[k].time));
+    position = (std::max)(position, (decoded[k].position - states[k].position)
+                                        .cwiseAbs()
+                                        .maxCoeff());
+    velocity = (std::max)(velocity, (decoded[k].velocity - states[k].velocity)
+                                        .cwiseAbs()
+                                        .maxCoeff());
+    // Small-angle magnitude of the attitude error, |skew(a)|_F = sqrt(2)|a|
+    const ennui::Matrix3x3 error =
+        decoded[k].attitude.transpose() * states[k].attitude;
+    attitude = (std::max)(attitude,
+                          (error - error.transpose()).norm() / (2 * sqrt(2.0)));
+  }
+  const double ratio = states.size() * 16 * 8.0 / bytes.size();
+  PRINT_txt("quantized compression ratio " << ratio << ", max error: time "
+                                           << time << " s, position "
+                                           << position << " m, velocity "
+                                           << velocity << " m/s, attitude "
+                                           << attitude << " rad");
+  REQUIRE(time <= 0.5 * encoding.time_step * (1 + 1e-6));
+  // q * step is itself rounded, by up to an ulp at ECEF magnitudes
+  const double ecef_ulp = 8e6 * std::numeric_limits<double>::epsilon();
+  REQUIRE(position <= 0.5 * encoding.position_step + ecef_ulp);
+  REQUIRE(velocity <= 0.5 * encoding.velocity_step * (1 + 1e-6));
+  REQUIRE(attitude <= 2 * encoding.attitude_step);
+  REQUIRE(ratio >= 5);
+}
+
+//! Random access by record and by time loads only the containing block
+TEST_CASE("trajectory seek", "[io][trajectory]") {
+  const std::vector<StatePvaSO3> states = trajectory(3000, 0.01);
+  TrajectoryEncoding encoding;
+  encoding.mode = TrajectoryEncoding::LOSSLESS;
+  encoding.block_records = 500;
+  std::istringstream file(encode(states, encoding));
+  TrajectoryReader reader(file);
+  REQUIRE(reader.records() == 3000);
+  REQUIRE(reader.blocks() == 6);
+
+  StatePvaSO3 s;
+  for (std::size_t record : {2999, 0, 1234, 500, 499, 1501}) {
+    reader.seek(record);
+    REQUIRE(reader.read(s));
+    REQUIRE(identical(s, states[record]));
+  }
+  // Reading continues across block boundaries after a seek
+  reader.seek(498);
+  for (std::size_t k = 498; k < 503; ++k) {
+    REQUIRE(reader.read(s));
+    REQUIRE(identical(s, states[k]));
+  }
+
+  reader.seek_time(states[1750].time - 0.004);
+  REQUIRE(reader.read(s));
+  REQUIRE(identical(s, states[1750]));
+  reader.seek_time(states[1000].time);
+  REQUIRE(reader.read(s));
+  REQUIRE(identical(s, states[1000]));
+
+  reader.seek(3000);
+  REQUIRE_FALSE(reader.read(s));
+}
+
+//! Invalid input is reported, not misread
+TEST_CASE("trajectory errors", "[io][trajectory]") {
+  std::istringstream garbage("not a trajectory file at all, really not");
+  REQUIRE_THROWS_AS(TrajectoryReader(garbage), std::runtime_error);
+
+  // Truncated file: footer missing
+  std::string bytes = encode(trajectory(10, 0.01), TrajectoryEncoding());
+  std::istringstream truncated(bytes.substr(0, bytes.size() - 20));
+  REQUIRE_THROWS_AS(TrajectoryReader(truncated), std::runtime_error);
+
+  // Index offset past the footer, and a block count larger than the index
+  // could hold, are rejected before anything is allocated
+  const std::size_t footer = bytes.size() - 16;
+  std::uint64_t index_offset = 0;
+  for (int i = 7; i >= 0; --i) {
+    index_offset = (index_offset << 8) |
+                   static_cast<unsigned char>(bytes[footer + i]);
+  }
+  std::string bad_offset = bytes;
+  bad_offset[footer + 7] = '\x7f';
+  std::istringstream past_footer(bad_offset);
+  REQUIRE_THROWS_WITH(TrajectoryReader(past_footer),
+                      "corrupt trajectory index");
+  std::string bad_count = bytes;
+  bad_count[index_offset + 8 + 5] = '\x7f';  // about 2^46 blocks
+  std::istringstream huge_index(bad_count);
+  REQUIRE_THROWS_WITH(TrajectoryReader(huge_index),
+                      "corrupt trajectory index");
+
+  // Block sizes from the file are checked before anything is allocated: the
+  // single block follows the 48-byte header, its record count and byte size
+  // first; the first index entry ends with its record count
+  auto patch = [](std::string data, std::size_t at, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      data[at + i] = static_cast<char>(value >> 8 * i);
+    }
+    return data;
+  };
+  const std::size_t entry_records = index_offset + 16 + 24;
+  std::istringstream oversized(patch(bytes, entry_records, 5000));
+  REQUIRE_THROWS_WITH(TrajectoryReader(oversized), "corrupt trajectory index");
+  StatePvaSO3 state;
+  std::istringstream huge_block(patch(bytes, 52, 0x7fffffff));
+  TrajectoryReader huge_block_reader(huge_block);
+  REQUIRE_THROWS_WITH(huge_block_reader.read(state),
+                      "corrupt trajectory block");
+  std::istringstream many_records(
+      patch(patch(bytes, 48, 4000), entry_records, 4000));
+  TrajectoryReader many_records_reader(many_records);
+  REQUIRE_THROWS_WITH(many_records_reader.read(state),
+                      "corrupt trajectory block");
+
+  std::stringstream file;
+  TrajectoryEncoding encoding;
+  encoding.position_step = 0;
+  REQUIRE_THROWS_AS(TrajectoryWriter(file, encoding), std::invalid_argument);
+  encoding = TrajectoryEncoding();
+  encoding.block_records = ennui::io::detail::MAX_BLOCK_RECORDS + 1;
+  REQUIRE_THROWS_AS(TrajectoryWriter(file, encoding), std::invalid_argument);
+}
+
+//! Encode and decode throughput
+TEST_CASE("trajectory throughput", "[.][bench][io]") {
+  const std::vector<StatePvaSO3> states = trajectory(200000, 0.01);
+  for (const TrajectoryEncoding::Mode mode :
+       {TrajectoryEncoding::QUANTIZED, TrajectoryEncoding::LOSSLESS}) {
+    TrajectoryEncoding encoding;
+    encoding.mode = mode;
+    const auto t0 = std::chrono::steady_clock::now();
+    const std::string bytes = encode(states, encoding);
+    const auto t1 = std::chrono::steady_clock::now();
+    const std::vector<StatePvaSO3> decoded = decode(bytes);
+    const auto t2 = std::chrono::steady_clock::now();
+    const double n = static_cast<double>(states.size());
+    std::cout << (mode == TrajectoryEncoding::LOSSLESS ? "lossless"
+                                                       : "quantized")
+              << ": " << bytes.size() / n << " bytes/record, encode "
+              << n / std::chrono::duration<double>(t1 - t0).count()
+              << " records/s, decode "
+              << n / std::chrono::duration<double>(t2 - t1).count()
+              << " records/s" << std::endl;
+  }
+}
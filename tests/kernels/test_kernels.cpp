@@ -0,0 +1,220 @@
+#include <stdlib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "ecef.hpp"
+#include "frame_transform.hpp"
+#include "gravitation.hpp"
+#include "kernels.hpp"
+#include "landmarks.hpp"
+#include "rotation.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::Matrix3x3;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::Wgs84;
+using ennui::kernels::Isa;
+
+//! Every variant supported by the host
+static std::vector<Isa> host_variants() {
+  std::vector<Isa> variants;
+  const Isa all[] = {Isa::BASELINE, Isa::AVX2, Isa::AVX512};
+  for (const Isa isa : all) {
+    if (static_cast<int>(isa) <= static_cast<int>(ennui::kernels::detected_isa()))
+      variants.push_back(isa);
+  }
+  return variants;
+}
+
+//! Restores the active variant when leaving scope
+struct IsaGuard {
+  Isa saved;
+  IsaGuard() : saved(ennui::kernels::active_isa()) {}
+  ~IsaGuard() { ennui::kernels::select_isa(saved); }
+};
+
+static std::vector<ImuSample> synthetic_samples(std::size_t n) {
+  std::vector<ImuSample> samples(n);
+  const double dt = 1e-2;
+  for (std::size_t k = 0; k < n; ++k) {
+    const double t = k * dt;
+    samples[k] = ImuSample{t + dt, dt,
+                           Vector3{0.2 * sin(t), 0.1 * cos(0.5 * t), 9.81},
+                           Vector3{0.01 * cos(t), -0.02, 0.03 * sin(0.2 * t)}};
+  }
+  return samples;
+}
+
+// Kernel call from a static initializer of another translation unit, which
+// may run before those of the kernel library
+static const double static_position[3] = {1115e3, -4843e3, 3983e3};
+static const Vector3 static_gravitation =
+    ennui::kernels::gravitation_ecef(Vector3(static_position));
+
+//! Kernels are usable during static initialization
+TEST_CASE("kernels static initialization", "[kernels]") {
+  const Vector3 expected = ennui::geodetic::gravitation_ecef<Wgs84>(
+      Vector3(static_position));
+  REQUIRE_REL(static_gravitation, expected, 1e-13);
+}
+
+//! Variant names round-trip, and selection never exceeds the host
+TEST_CASE("isa selection", "[kernels]") {
+  IsaGuard guard;
+  Isa isa = Isa::BASELINE;
+  REQUIRE(ennui::kernels::parse_isa("avx2", isa));
+  REQUIRE(isa == Isa::AVX2);
+  REQUIRE_FALSE(ennui::kernels::parse_isa("sse9", isa));
+  REQUIRE(isa == Isa::AVX2);
+  REQUIRE(std::string(ennui::kernels::isa_name(Isa::AVX512)) == "avx512");
+
+  const Isa best = ennui::kernels::detected_isa();
+  REQUIRE(ennui::kernels::select_isa(Isa::AVX512) == best);
+  REQUIRE(ennui::kernels::active_isa() == best);
+  REQUIRE(ennui::kernels::select_isa(Isa::BASELINE) == Isa::BASELINE);
+  std::cout << "Kernel variants: detected " << ennui::kernels::isa_name(best)
+            << ", active at load "
+            << ennui::kernels::isa_name(guard.saved) << std::endl;
+}
+
+//! ENNUI_ISA overrides the detected variant
+TEST_CASE("isa environment override", "[kernels]") {
+  const char *saved = getenv("ENNUI_ISA");
+  const std::string restore = saved ? saved : "";
+  setenv("ENNUI_ISA", "baseline", 1);
+  REQUIRE(ennui::kernels::default_isa() == Isa::BASELINE);
+  setenv("ENNUI_ISA", "unknown", 1);
+  REQUIRE(ennui::kernels::default_isa() == ennui::kernels::detected_isa());
+  if (saved) {
+    setenv("ENNUI_ISA", restore.c_str(), 1);
+  } else {
+    unsetenv("ENNUI_ISA");
+  }
+}
+
+//! Each variant agrees with the header-only library
+TEST_CASE("kernel variants", "[kernels]") {
+  using ennui::geodetic::gravitation_ecef;
+  using ennui::geodetic::position_geodetic_to_ecef;
+  IsaGuard guard;
+  const prop_mean &pm = WhiteHouse_mean_prop;
+  const std::vector<ImuSample> samples = synthetic_samples(500);
+
+  // Header-only references
+  const Vector3 gamma = gravitation_ecef<Wgs84>(pm.prior.position);
+  StatePvaSO3 reference{0.0, pm.prior.position, pm.prior.velocity,
+                        pm.prior.attitude};
+  for (const ImuSample &s : samples) {
+    ennui::mechanization::ecef::fwd_pva_S03_rt<Wgs84>(
+        reference, gravitation_ecef<Wgs84>(reference.position), s, reference);
+  }
+  const double llh[9] = {WhiteHouse_LLH[0],     WhiteHouse_LLH[1],
+                         WhiteHouse_LLH[2],     SydneyOpera_LLH[0],
+                         SydneyOpera_LLH[1],    SydneyOpera_LLH[2],
+                         AconcaguaPeak_LLH[0], AconcaguaPeak_LLH[1],
+                         AconcaguaPeak_LLH[2]};
+  const Vector3 ecef[3] = {WhiteHouse_ECEF, SydneyOpera_ECEF,
+                           AconcaguaPeak_ECEF};
+  const Vector3 rotation{0.3, -0.2, 0.1};
+  Vector3 step_position, step_velocity;
+  Matrix3x3 step_attitude;
+  ennui::mechanization::ecef::fwd_pva_S03_rt<Wgs84>(
+      pm.prior.position, pm.prior.velocity, pm.prior.attitude, gamma,
+      pm.specific_force, pm.angular_rate, pm.dt, step_position, step_velocity,
+      step_attitude);
+
+  for (const Isa isa : host_variants()) {
+    ennui::kernels::select_isa(isa);
+    PRINT_txt(std::string("Kernel variant ") + ennui::kernels::isa_name(isa));
+    // Baseline is the header-only code, bit for bit; FMA variants differ by
+    // rounding only
+    const bool exact = (isa == Isa::BASELINE);
+    const double tolerance = exact ? 1e-15 : 1e-13;
+
+    Vector3 position, velocity;
+    Matrix3x3 attitude;
+    ennui::kernels::fwd_pva_S03(pm.prior.position, pm.prior.velocity,
+                                pm.prior.attitude, gamma, pm.specific_force,
+                                pm.angular_rate, pm.dt, position, velocity,
+                                attitude);
+    REQUIRE_REL(position, pm.posterior.position, tolerance);
+    REQUIRE_REL(velocity, pm.posterior.velocity, tolerance);
+    REQUIRE_REL(attitude.reshaped(), pm.posterior.attitude.reshaped(),
+                tolerance);
+    if (exact) {
+      REQUIRE(position == step_position);
+      REQUIRE(velocity == step_velocity);
+      REQUIRE(attitude == step_attitude);
+    }
+
+    StatePvaSO3 state{0.0, pm.prior.position, pm.prior.velocity,
+                      pm.prior.attitude};
+    std::vector<StatePvaSO3> history(samples.size());
+    ennui::kernels::propagate(state, samples.data(), samples.size(),
+                              history.data());
+    REQUIRE(state.time == reference.time);
+    REQUIRE(history.back().position == state.position);
+    if (exact) {
+      REQUIRE(state.position == reference.position);
+      REQUIRE(state.velocity == reference.velocity);
+      REQUIRE(state.attitude == reference.attitude);
+    } else {
+      REQUIRE_REL(state.position, reference.position, tolerance);
+      REQUIRE_REL(state.velocity, reference.velocity, 1e3 * tolerance);
+    }
+    PRINT_ERRORS(state.position, reference.position, "   batch propagation");
+
+    REQUIRE_REL(ennui::kernels::gravitation_ecef(WhiteHouse_ECEF),
+                WhiteHouse_gamma, tolerance);
+    REQUIRE_REL(ennui::kernels::R3_to_SO3(rotation).reshaped(),
+                ennui::math::R3_to_SO3(rotation).reshaped(), tolerance);
+
+    double out[9];
+    ennui::kernels::position_geodetic_to_ecef(llh, out, 3);
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE_REL(ennui::ConstMapVector3(out + 3 * i), ecef[i], 1e-14);
+    }
+  }
+}
+
+/**
+ * Throughput of each variant. Hidden by default, run with:
+ * Ennui_test "[bench]"
+ */
+TEST_CASE("kernel variants throughput", "[.][bench][kernels]") {
+  typedef std::chrono::steady_clock Clock;
+  IsaGuard guard;
+  const std::vector<ImuSample> samples = synthetic_samples(1000000);
+  std::vector<double> llh(3 * samples.size()), ecef(3 * samples.size());
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    llh[3 * i] = -80.0 + 160.0 * i / samples.size();
+    llh[3 * i + 1] = -180.0 + 360.0 * i / samples.size();
+    llh[3 * i + 2] = 100.0;
+  }
+  const prop_mean &pm = WhiteHouse_mean_prop;
+
+  for (const Isa isa : host_variants()) {
+    ennui::kernels::select_isa(isa);
+    StatePvaSO3 state{0.0, pm.prior.position, pm.prior.velocity,
+                      pm.prior.attitude};
+    Clock::time_point start = Clock::now();
+    ennui::kernels::propagate(state, samples.data(), samples.size(), nullptr);
+    const double propagate_s =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    ennui::kernels::position_geodetic_to_ecef(llh.data(), ecef.data(),
+                                              samples.size());
+    const double geodetic_s =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << ennui::kernels::isa_name(isa) << ": propagate "
+              << 1e9 * propagate_s / samples.size() << " ns/step, geodetic "
+              << 1e9 * geodetic_s / samples.size() << " ns/point" << std::endl;
+  }
+}
@@ -0,0 +1,119 @@
+#include <vector>
+
+#include "adaptive_step.hpp"
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::AdaptiveStepper;
+using ennui::mechanization::ecef::AdaptiveStepReport;
+using ennui::mechanization::ecef::AdaptiveStepTolerance;
+using ennui::mechanization::ecef::evaluate_adaptive_step;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+
+/**
+ * @brief Cruise, maneuver, cruise at 100 Hz
+ *
+ * Cruise holds the specific force that balances gravitation at the start and
+ * a slow constant turn; the maneuver adds oscillating rates.
+ */
+static std::vector<ImuSample> flight(std::size_t cruise, std::size_t maneuver) {
+  const double dt = 0.01;
+  const StatePvaSO3 s = landmark_start_state();
+  const Vector3 f_cruise =
+      -(s.attitude.transpose() * gravitation_ecef<Wgs84>(s.position));
+  const Vector3 w_cruise{0, 0, 1e-3};
+  std::vector<ImuSample> samples;
+  for (std::size_t k = 0; k < 2 * cruise + maneuver; ++k) {
+    const double t = k * dt;
+    ImuSample sample{t + dt, dt, f_cruise, w_cruise};
+    if (k >= cruise && k < cruise + maneuver) {
+      sample.angular_rate += Vector3{0.2 * sin(2 * t), 0.1 * cos(3 * t), 0};
+      sample.specific_force += Vector3{2 * sin(t), 0, 0.5 * cos(2 * t)};
+    }
+    samples.push_back(sample);
+  }
+  return samples;
+}
+
+//! Stepper that must never merge reproduces full-rate propagation
+static void require_full_rate(const AdaptiveStepTolerance &tolerance) {
+  const std::vector<ImuSample> samples = flight(200, 100);
+  AdaptiveStepper<Wgs84> stepper(landmark_start_state(), tolerance);
+  StatePvaSO3 full = landmark_start_state();
+  for (const ImuSample &s : samples) {
+    stepper.push(s);
+    fwd_pva_S03_rt<Wgs84>(full, gravitation_ecef<Wgs84>(full.position), s,
+                          full);
+  }
+  stepper.flush();
+  REQUIRE(stepper.steps() == samples.size());
+  REQUIRE(stepper.state().position == full.position);
+  REQUIRE(stepper.state().attitude == full.attitude);
+}
+
+//! Zero tolerances never merge, even during cruise
+TEST_CASE("adaptive step zero tolerance", "[mechanization][adaptive]") {
+  AdaptiveStepTolerance tolerance;
+  tolerance.angular_rate_change = 0;
+  tolerance.specific_force_change = 0;
+  tolerance.alpha = 0;
+  tolerance.max_dt = 0;
+  require_full_rate(tolerance);
+}
+
+//! max_samples = 1 degenerates to full rate whatever the other limits
+TEST_CASE("adaptive step single sample", "[mechanization][adaptive]") {
+  AdaptiveStepTolerance tolerance;
+  tolerance.max_samples = 1;
+  require_full_rate(tolerance);
+}
+
+//! Cruise merges up to the limits; maneuvers fall back to full rate
+TEST_CASE("adaptive step flight", "[mechanization][adaptive]") {
+  const std::size_t cruise = 6000, maneuver = 1000;
+  const std::vector<ImuSample> samples = flight(cruise, maneuver);
+  const AdaptiveStepTolerance tolerance;
+
+  AdaptiveStepper<Wgs84> stepper(landmark_start_state(), tolerance);
+  std::uint64_t steps_before = 0;
+  for (std::size_t k = 0; k < samples.size(); ++k) {
+    if (k == cruise) {
+      // Cruise steps are limited by max_dt (10 samples)
+      REQUIRE(stepper.pending() == 10);
+      steps_before = stepper.steps();
+      REQUIRE(steps_before == cruise / 10 - 1);
+    }
+    stepper.push(samples[k]);
+    if (k + 1 == cruise + maneuver) {
+      REQUIRE(stepper.steps() - steps_before >= 0.95 * maneuver);
+    }
+  }
+  stepper.flush();
+  REQUIRE(stepper.state().time == samples.back().time);
+
+  const AdaptiveStepReport report = evaluate_adaptive_step<Wgs84>(
+      landmark_start_state(), samples.data(), samples.size(), tolerance);
+  REQUIRE(report.steps == stepper.steps());
+  REQUIRE(report.samples == samples.size());
+  PRINT_txt("adaptive step reduction " << report.reduction()
+                                       << "x, max error: position "
+                                       << report.position_error
+                                       << " m, velocity "
+                                       << report.velocity_error
+                                       << " m/s, attitude "
+                                       << report.attitude_error);
+  // 2 minutes of cruise at 10x, the maneuver at full rate
+  REQUIRE(report.reduction() > 5.5);
+  // Dominated by the Earth-rate attitude term of the longer cruise steps
+  REQUIRE(report.position_error < 5e-2);
+  REQUIRE(report.velocity_error < 1e-3);
+  REQUIRE(report.attitude_error < 1e-6);
+}
@@ -0,0 +1,148 @@
+#include <chrono>
+#include <vector>
+
+#include "attitude_scan.hpp"
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "rotation.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::Matrix3x3;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::AttitudeScanConfig;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+using ennui::mechanization::ecef::scan_attitude;
+using ennui::mechanization::ecef::scan_pva;
+
+static double orthonormality(const Matrix3x3 &R) {
+  return (R.transpose() * R - Matrix3x3::Identity()).norm();
+}
+
+//! Constant body rate: the scan reproduces the closed form
+TEST_CASE("attitude scan constant rate", "[mechanization][scan]") {
+  const double dt = 0.01;
+  const std::size_t count = 20000;
+  const Vector3 rate{0.1, -0.05, 0.2};
+  std::vector<ImuSample> samples(count,
+                                 ImuSample{0, dt, Vector3::Zero(), rate});
+  const Matrix3x3 C0 = landmark_start_state().attitude;
+  std::vector<Matrix3x3> attitudes(count);
+  AttitudeScanConfig config;
+  config.threads = 4;
+  scan_attitude<Wgs84>(C0, samples.data(), count, attitudes.data(), config);
+
+  // Serial chain, first order in the Earth rate
+  StatePvaSO3 state = landmark_start_state();
+  std::vector<Matrix3x3> serial;
+  for (const ImuSample &s : samples) {
+    fwd_pva_S03_rt<Wgs84>(state, Vector3::Zero(), s, state);
+    serial.push_back(state.attitude);
+  }
+
+  double max_error = 0, max_serial = 0, max_orthonormality = 0;
+  for (std::size_t k = 0; k < count; k += 997) {
+    const double T = (k + 1) * dt;
+    const double angle = Wgs84::EARTH_ROTATION_RATE * T;
+    Matrix3x3 earth;
+    earth << cos(angle), sin(angle), 0, -sin(angle), cos(angle), 0, 0, 0, 1;
+    const Matrix3x3 expected =
+        earth * C0 * ennui::math::R3_to_SO3(rate * T);
+    max_error = (std::max)(max_error, (attitudes[k] - expected).norm());
+    max_serial = (std::max)(max_serial, (serial[k] - expected).norm());
+    max_orthonormality =
+        (std::max)(max_orthonormality, orthonormality(attitudes[k]));
+  }
+  std::cout << "Attitude scan vs closed form, " << count
+            << " samples: max error " << max_error
+            << " (serial mechanization " << max_serial << "), orthonormality "
+            << max_orthonormality << std::endl;
+  REQUIRE(max_error < 1e-11);
+  REQUIRE(max_error < max_serial);
+  REQUIRE(max_orthonormality < 1e-13);
+}
+
+//! Thread count changes only the association of the products
+TEST_CASE("attitude scan threads", "[mechanization][scan]") {
+  const std::vector<ImuSample> samples = synthetic_imu_samples(10007, 0.01);
+  const Matrix3x3 C0 = landmark_start_state().attitude;
+  std::vector<Matrix3x3> one(samples.size()), many(samples.size());
+  AttitudeScanConfig config;
+  config.threads = 1;
+  scan_attitude<Wgs84>(C0, samples.data(), samples.size(), one.data(),
+                       config);
+  config.threads = 7;
+  config.normalize_every = 16;
+  scan_attitude<Wgs84>(C0, samples.data(), samples.size(), many.data(),
+                       config);
+  double max_difference = 0;
+  for (std::size_t k = 0; k < samples.size(); ++k) {
+    max_difference = (std::max)(max_difference, (one[k] - many[k]).norm());
+  }
+  REQUIRE(max_difference < 1e-12);
+}
+
+//! Agreement with a chain of fwd_pva_S03_rt steps
+TEST_CASE("attitude scan vs mechanization", "[mechanization][scan]") {
+  const std::vector<ImuSample> samples = synthetic_imu_samples(10000, 0.01);
+  std::vector<StatePvaSO3> scanned(samples.size());
+  AttitudeScanConfig config;
+  config.threads = 3;
+  scan_pva<Wgs84>(landmark_start_state(), samples.data(), samples.size(),
+                  scanned.data(), config);
+
+  StatePvaSO3 state = landmark_start_state();
+  double max_attitude = 0, max_velocity = 0, max_position = 0;
+  for (std::size_t k = 0; k < samples.size(); ++k) {
+    fwd_pva_S03_rt<Wgs84>(state, gravitation_ecef<Wgs84>(state.position),
+                          samples[k], state);
+    REQUIRE(scanned[k].time == state.time);
+    max_attitude = (std::max)(max_attitude,
+                              (scanned[k].attitude - state.attitude).norm());
+    max_velocity = (std::max)(max_velocity,
+                              (scanned[k].velocity - state.velocity).norm());
+    max_position = (std::max)(max_position,
+                              (scanned[k].position - state.position).norm());
+  }
+  std::cout << "Scan vs mechanization over 100 s, max difference: attitude "
+            << max_attitude << ", velocity " << max_velocity
+            << " m/s, position " << max_position << " m" << std::endl;
+  // Second-order coupling of body and Earth rates, omega |w| dt^2 per step,
+  // dropped by fwd_pva_S03_rt and kept by the scan
+  REQUIRE(max_attitude < 1e-5);
+  REQUIRE(max_velocity < 1e-3);
+  REQUIRE(max_position < 1e-2);
+}
+
+//! Serial mechanization against the scan over a long log
+TEST_CASE("attitude scan throughput", "[.][bench][mechanization]") {
+  const std::vector<ImuSample> samples = synthetic_imu_samples(4000000, 0.01);
+  std::vector<Matrix3x3> attitudes(samples.size());
+  std::vector<StatePvaSO3> states(samples.size());
+
+  const auto t0 = std::chrono::steady_clock::now();
+  StatePvaSO3 state = landmark_start_state();
+  for (const ImuSample &s : samples) {
+    fwd_pva_S03_rt<Wgs84>(state, gravitation_ecef<Wgs84>(state.position), s,
+                          state);
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  scan_attitude<Wgs84>(landmark_start_state().attitude, samples.data(),
+                       samples.size(), attitudes.data());
+  const auto t2 = std::chrono::steady_clock::now();
+  scan_pva<Wgs84>(landmark_start_state(), samples.data(), samples.size(),
+                  states.data());
+  const auto t3 = std::chrono::steady_clock::now();
+  typedef std::chrono::duration<double> Seconds;
+  std::cout << samples.size() << " samples on "
+            << std::thread::hardware_concurrency()
+            << " threads: serial mechanization " << Seconds(t1 - t0).count()
+            << " s, attitude scan " << Seconds(t2 - t1).count()
+            << " s, scan pva " << Seconds(t3 - t2).count() << " s"
+            << std::endl;
+}
@@ -0,0 +1,150 @@
+#include <chrono>
+#include <vector>
+
+#include "gravitation.hpp"
+#include "imu_calibration.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::Matrix3x3;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ImuBias;
+using ennui::mechanization::ImuCalibration;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+
+//! Scale factors (ppm to percent level) and misalignments (mrad level)
+static ImuCalibration error_model(const ImuBias &bias) {
+  Matrix3x3 Mg, Ma;
+  Mg << 3e-3, 1e-3, -2e-3, 5e-4, -1e-3, 1.5e-3, -7e-4, 2e-4, 2e-3;
+  Ma << -2e-3, -4e-4, 1e-3, 8e-4, 1e-3, -6e-4, 3e-4, -1.2e-3, 5e-4;
+  return ImuCalibration(Mg, Ma, bias);
+}
+
+//! Raw measurement of a true sample under the model in calibration
+static ImuSample corrupt(const ImuSample &s, const ImuCalibration &c) {
+  ImuSample raw = s;
+  raw.angular_rate =
+      c.bias().gyro + c.gyro_correction().inverse() * s.angular_rate;
+  raw.specific_force =
+      c.bias().accel + c.accel_correction().inverse() * s.specific_force;
+  return raw;
+}
+
+static ImuBias bias_at(double t) {
+  ImuBias bias;
+  bias.gyro = Vector3{1e-4, -2e-4, 5e-5 * (1 + t)};
+  bias.accel = Vector3{0.02, -0.01 * t, 0.05};
+  return bias;
+}
+
+//! Correction inverts the error model
+TEST_CASE("calibration correction", "[mechanization][calibration]") {
+  ImuCalibration calibration = error_model(bias_at(0));
+  for (std::size_t k = 0; k < 10; ++k) {
+    const ImuSample s = synthetic_imu_sample(k, 0.1);
+    ImuSample corrected = corrupt(s, calibration);
+    REQUIRE_FALSE((corrected.angular_rate - s.angular_rate).norm() < 1e-6);
+    calibration.apply(corrected, corrected);
+    REQUIRE((corrected.angular_rate - s.angular_rate).norm() < 1e-15);
+    REQUIRE((corrected.specific_force - s.specific_force).norm() < 1e-14);
+    REQUIRE(corrected.time == s.time);
+    REQUIRE(corrected.dt == s.dt);
+  }
+}
+
+//! Fused step equals a separate correction pass, with a time-varying bias
+TEST_CASE("calibration fused step", "[mechanization][calibration]") {
+  const double dt = 0.01;
+  ImuCalibration calibration = error_model(bias_at(0));
+  StatePvaSO3 fused = landmark_start_state(), two_pass = fused, truth = fused;
+  for (std::size_t k = 0; k < 500; ++k) {
+    calibration.set_bias(bias_at(k * dt));
+    const ImuSample s = synthetic_imu_sample(k, dt);
+    const ImuSample raw = corrupt(s, calibration);
+
+    fwd_pva_S03_rt<Wgs84>(fused, gravitation_ecef<Wgs84>(fused.position), raw,
+                          calibration, fused);
+    ImuSample corrected;
+    calibration.apply(raw, corrected);
+    fwd_pva_S03_rt<Wgs84>(two_pass,
+                          gravitation_ecef<Wgs84>(two_pass.position),
+                          corrected, two_pass);
+    fwd_pva_S03_rt<Wgs84>(truth, gravitation_ecef<Wgs84>(truth.position), s,
+                          truth);
+  }
+  REQUIRE(fused.time == two_pass.time);
+  REQUIRE(fused.position == two_pass.position);
+  REQUIRE(fused.velocity == two_pass.velocity);
+  REQUIRE(fused.attitude == two_pass.attitude);
+  // Only round-off in the correction separates the result from the truth
+  REQUIRE((fused.position - truth.position).norm() < 1e-6);
+  REQUIRE((fused.attitude - truth.attitude).norm() < 1e-12);
+}
+
+//! Batched replay and identity calibration
+TEST_CASE("calibration batch", "[mechanization][calibration]") {
+  const double dt = 0.01;
+  const ImuCalibration calibration = error_model(bias_at(1));
+  std::vector<ImuSample> raw;
+  for (std::size_t k = 0; k < 300; ++k) {
+    raw.push_back(corrupt(synthetic_imu_sample(k, dt), calibration));
+  }
+
+  StatePvaSO3 batch = landmark_start_state(), single = batch, plain = batch;
+  fwd_pva_S03_rt<Wgs84>(batch, raw.data(), raw.size(), calibration);
+  for (const ImuSample &s : raw) {
+    fwd_pva_S03_rt<Wgs84>(single, gravitation_ecef<Wgs84>(single.position), s,
+                          calibration, single);
+  }
+  REQUIRE(batch.time == single.time);
+  REQUIRE(batch.position == single.position);
+  REQUIRE(batch.attitude == single.attitude);
+
+  // Identity calibration leaves the step unchanged
+  StatePvaSO3 identity = plain;
+  fwd_pva_S03_rt<Wgs84>(identity, raw.data(), raw.size(), ImuCalibration());
+  for (const ImuSample &s : raw) {
+    fwd_pva_S03_rt<Wgs84>(plain, gravitation_ecef<Wgs84>(plain.position), s,
+                          plain);
+  }
+  REQUIRE(identity.position == plain.position);
+  REQUIRE(identity.attitude == plain.attitude);
+}
+
+//! Fused replay against a correction pass followed by propagation
+TEST_CASE("calibration throughput", "[.][bench][mechanization]") {
+  const double dt = 0.01;
+  const std::size_t count = 2000000;
+  const ImuCalibration calibration = error_model(bias_at(0));
+  std::vector<ImuSample> raw;
+  raw.reserve(count);
+  for (std::size_t k = 0; k < count; ++k) {
+    raw.push_back(corrupt(synthetic_imu_sample(k, dt), calibration));
+  }
+
+  StatePvaSO3 two_pass = landmark_start_state(), fused = two_pass;
+  std::vector<ImuSample> corrected(count);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (std::size_t k = 0; k < count; ++k) {
+    calibration.apply(raw[k], corrected[k]);
+  }
+  for (const ImuSample &s : corrected) {
+    fwd_pva_S03_rt<Wgs84>(two_pass,
+                          gravitation_ecef<Wgs84>(two_pass.position), s,
+                          two_pass);
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  fwd_pva_S03_rt<Wgs84>(fused, raw.data(), raw.size(), calibration);
+  const auto t2 = std::chrono::steady_clock::now();
+  REQUIRE(fused.position == two_pass.position);
+  std::cout << "Calibrated replay, " << count << " samples: two-pass "
+            << count / std::chrono::duration<double>(t1 - t0).count()
+            << " samples/s, fused "
+            << count / std::chrono::duration<double>(t2 - t1).count()
+            << " samples/s" << std::endl;
+}
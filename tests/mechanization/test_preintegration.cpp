@@ -0,0 +1,155 @@
+#include <vector>
+
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "preintegration.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::Matrix3x3;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+using ennui::mechanization::ecef::ImuNoise;
+using ennui::mechanization::ecef::ImuPreintegration;
+
+static ImuPreintegration preintegrate(const std::vector<ImuSample> &samples,
+                                      const Vector3 &bias_gyro,
+                                      const Vector3 &bias_accel) {
+  ImuPreintegration p(bias_gyro, bias_accel);
+  for (const ImuSample &s : samples) p.integrate(s);
+  return p;
+}
+
+static bool near(double actual, double expected, double tolerance) {
+  return fabs(actual - expected) <= tolerance * fabs(expected);
+}
+
+//! Predicting across a segment agrees with step-by-step mechanization
+TEST_CASE("preintegration vs mechanization", "[mechanization][preint]") {
+  const Vector3 bias_gyro{1e-3, -2e-3, 5e-4};
+  const Vector3 bias_accel{0.02, -0.01, 0.03};
+  std::vector<ImuSample> samples = synthetic_imu_samples(100, 0.01);
+
+  // Mechanize the bias-corrected samples
+  StatePvaSO3 expected = landmark_start_state();
+  for (const ImuSample &s : samples) {
+    ImuSample corrected = s;
+    corrected.angular_rate -= bias_gyro;
+    corrected.specific_force -= bias_accel;
+    fwd_pva_S03_rt<Wgs84>(expected,
+                          gravitation_ecef<Wgs84>(expected.position),
+                          corrected, expected);
+  }
+
+  const ImuPreintegration p = preintegrate(samples, bias_gyro, bias_accel);
+  REQUIRE(p.samples() == samples.size());
+  REQUIRE(near(p.duration(), 1.0, 1e-12));
+  StatePvaSO3 actual;
+  p.predict<Wgs84>(landmark_start_state(), bias_gyro, bias_accel, actual);
+
+  PRINT_ERRORS(actual.position, expected.position, "position");
+  PRINT_ERRORS(actual.velocity, expected.velocity, "velocity");
+  REQUIRE(near(actual.time, expected.time, 1e-12));
+  PRINT_txt("attitude error " << (actual.attitude - expected.attitude).norm());
+  // Residuals are the discretization of fwd_pva_S03 (first-order Earth-rate
+  // terms, gravitation held at each prior position); they shrink with dt
+  REQUIRE((actual.position - expected.position).norm() < 2e-5);
+  REQUIRE((actual.velocity - expected.velocity).norm() < 2e-5);
+  REQUIRE((actual.attitude - expected.attitude).norm() < 5e-7);
+}
+
+//! First-order bias correction is close to re-integration at the new bias
+TEST_CASE("preintegration bias correction", "[mechanization][preint]") {
+  const std::vector<ImuSample> samples = synthetic_imu_samples(200, 0.005);
+  const ImuPreintegration p =
+      preintegrate(samples, Vector3::Zero(), Vector3::Zero());
+
+  const Vector3 bias_gyro{2e-3, -1e-3, 3e-3};
+  const Vector3 bias_accel{0.05, 0.02, -0.04};
+  const ImuPreintegration exact = preintegrate(samples, bias_gyro, bias_accel);
+
+  Matrix3x3 dR;
+  Vector3 dv, dp;
+  p.corrected(bias_gyro, bias_accel, dR, dv, dp);
+
+  const double uncorrected =
+      (p.delta_velocity() - exact.delta_velocity()).norm();
+  const double corrected = (dv - exact.delta_velocity()).norm();
+  PRINT_txt("velocity delta error, uncorrected " << uncorrected
+                                                  << ", corrected "
+                                                  << corrected);
+  REQUIRE(corrected < 1e-2 * uncorrected);
+  REQUIRE((dp - exact.delta_position()).norm() <
+          1e-2 * (p.delta_position() - exact.delta_position()).norm());
+  REQUIRE((dR - exact.delta_rotation()).norm() <
+          1e-2 * (p.delta_rotation() - exact.delta_rotation()).norm());
+}
+
+//! Bias Jacobians match central finite differences of re-integration
+TEST_CASE("preintegration jacobians", "[mechanization][preint]") {
+  const std::vector<ImuSample> samples = synthetic_imu_samples(100, 0.01);
+  const ImuPreintegration p =
+      preintegrate(samples, Vector3::Zero(), Vector3::Zero());
+  const double h = 1e-6;
+
+  for (int i = 0; i < 3; ++i) {
+    const Vector3 e = h * Vector3::Unit(i);
+    const ImuPreintegration gp = preintegrate(samples, e, Vector3::Zero());
+    const ImuPreintegration gm = preintegrate(samples, -e, Vector3::Zero());
+    const ImuPreintegration ap = preintegrate(samples, Vector3::Zero(), e);
+    const ImuPreintegration am = preintegrate(samples, Vector3::Zero(), -e);
+
+    // Rotation: log of the right perturbation, small-angle
+    const Matrix3x3 Rp = p.delta_rotation().transpose() * gp.delta_rotation();
+    const Matrix3x3 Rm = p.delta_rotation().transpose() * gm.delta_rotation();
+    const Vector3 phi_p{Rp(2, 1), Rp(0, 2), Rp(1, 0)};
+    const Vector3 phi_m{Rm(2, 1), Rm(0, 2), Rm(1, 0)};
+    const Vector3 dR_dbg = (phi_p - phi_m) / (2 * h);
+    REQUIRE((dR_dbg - p.d_rotation_d_bias_gyro().col(i)).norm() <
+            1e-3 * p.d_rotation_d_bias_gyro().col(i).norm());
+
+    const Vector3 dv_dbg =
+        (gp.delta_velocity() - gm.delta_velocity()) / (2 * h);
+    const Vector3 dp_dbg =
+        (gp.delta_position() - gm.delta_position()) / (2 * h);
+    const Vector3 dv_dba =
+        (ap.delta_velocity() - am.delta_velocity()) / (2 * h);
+    const Vector3 dp_dba =
+        (ap.delta_position() - am.delta_position()) / (2 * h);
+    REQUIRE((dv_dbg - p.d_velocity_d_bias_gyro().col(i)).norm() <
+            2e-2 * p.d_velocity_d_bias_gyro().col(i).norm());
+    REQUIRE((dp_dbg - p.d_position_d_bias_gyro().col(i)).norm() <
+            2e-2 * p.d_position_d_bias_gyro().col(i).norm());
+    REQUIRE((dv_dba - p.d_velocity_d_bias_accel().col(i)).norm() <
+            1e-6 * p.d_velocity_d_bias_accel().col(i).norm());
+    REQUIRE((dp_dba - p.d_position_d_bias_accel().col(i)).norm() <
+            1e-6 * p.d_position_d_bias_accel().col(i).norm());
+  }
+}
+
+//! Stationary, non-rotating segment: random-walk covariance in closed form
+TEST_CASE("preintegration covariance", "[mechanization][preint]") {
+  ImuNoise noise;
+  noise.gyro_noise_density = 1e-4;
+  noise.accel_noise_density = 1e-3;
+  ImuPreintegration p(Vector3::Zero(), Vector3::Zero(), noise);
+  const double dt = 0.01;
+  for (int k = 0; k < 500; ++k) {
+    p.integrate(ImuSample{(k + 1) * dt, dt, Vector3::Zero(), Vector3::Zero()});
+  }
+  const double T = p.duration();
+  const ennui::Matrix9x9 &P = p.covariance();
+  REQUIRE((P - P.transpose()).norm() == 0);
+  const double qg = 1e-8, qa = 1e-6;
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE(near(P(i, i), qg * T, 1e-12));
+    REQUIRE(near(P(3 + i, 3 + i), qa * T, 1e-12));
+    REQUIRE(near(P(3 + i, 6 + i), qa * T * T / 2, 1e-12));
+    REQUIRE(near(P(6 + i, 6 + i), qa * T * T * T / 3, 1e-3));
+  }
+}
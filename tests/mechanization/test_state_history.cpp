@@ -0,0 +1,129 @@
+#include <vector>
+
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "state_history.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+using ennui::mechanization::ecef::StateHistory;
+
+//! Propagate n samples, filling the history and returning all states
+static std::vector<StatePvaSO3> fill(StateHistory<Wgs84> &history,
+                                     std::size_t n, double dt) {
+  std::vector<StatePvaSO3> states(1, landmark_start_state());
+  history.reset(states[0]);
+  for (std::size_t k = 0; k < n; ++k) {
+    const ImuSample s = synthetic_imu_sample(k, dt);
+    StatePvaSO3 next;
+    fwd_pva_S03_rt<Wgs84>(states.back(),
+                          gravitation_ecef<Wgs84>(states.back().position), s,
+                          next);
+    history.push(next, s);
+    states.push_back(next);
+  }
+  return states;
+}
+
+//! Retained epochs are reproduced exactly
+TEST_CASE("history epochs", "[mechanization][history]") {
+  StateHistory<Wgs84> history(64);
+  const std::vector<StatePvaSO3> states = fill(history, 40, 0.01);
+  REQUIRE(history.size() == 41);
+  for (const StatePvaSO3 &expected : states) {
+    StatePvaSO3 actual;
+    REQUIRE(history.at(expected.time, actual));
+    REQUIRE(actual.position == expected.position);
+    REQUIRE(actual.velocity == expected.velocity);
+    REQUIRE(actual.attitude == expected.attitude);
+  }
+}
+
+//! Interpolation matches re-propagation with a fractional time step
+TEST_CASE("history interpolation", "[mechanization][history]") {
+  const double dt = 0.01;
+  StateHistory<Wgs84> history(64);
+  const std::vector<StatePvaSO3> states = fill(history, 40, dt);
+
+  double max_position = 0, max_velocity = 0, max_attitude = 0;
+  for (std::size_t k = 0; k < 40; ++k) {
+    for (const double fraction : {0.1, 0.37, 0.5, 0.9}) {
+      // Reference: re-run the propagator from the previous epoch
+      ImuSample s = synthetic_imu_sample(k, dt);
+      s.dt = fraction * dt;
+      s.time = states[k].time + s.dt;
+      StatePvaSO3 expected;
+      fwd_pva_S03_rt<Wgs84>(states[k],
+                            gravitation_ecef<Wgs84>(states[k].position), s,
+                            expected);
+
+      StatePvaSO3 actual;
+      REQUIRE(history.at(s.time, actual));
+      REQUIRE(actual.time == s.time);
+      max_position = (std::max)(
+          max_position, (actual.position - expected.position).norm());
+      max_velocity = (std::max)(
+          max_velocity, (actual.velocity - expected.velocity).norm());
+      max_attitude = (std::max)(
+          max_attitude, (actual.attitude - expected.attitude).norm());
+    }
+  }
+  std::cout << "History vs fractional re-propagation, max error: position "
+            << max_position << " m, velocity " << max_velocity
+            << " m/s, attitude " << max_attitude << std::endl;
+  REQUIRE(max_attitude < 1e-14);
+  // Bounded by the mean specific-force rotation, ~|w| dt |f| dt
+  REQUIRE(max_velocity < 1e-4);
+  REQUIRE(max_position < 1e-7);
+}
+
+//! Memory is bounded: the oldest states are discarded
+TEST_CASE("history capacity", "[mechanization][history]") {
+  StateHistory<Wgs84> history(16);
+  const std::vector<StatePvaSO3> states = fill(history, 100, 0.01);
+  REQUIRE(history.size() == 16);
+  REQUIRE(history.capacity() == 16);
+  REQUIRE(history.oldest_time() == states[85].time);
+  REQUIRE(history.newest_time() == states[100].time);
+
+  StatePvaSO3 state;
+  REQUIRE_FALSE(history.at(states[84].time, state));
+  REQUIRE_FALSE(history.at(states[100].time + 1e-3, state));
+  REQUIRE(history.at(states[85].time, state));
+  REQUIRE(state.position == states[85].position);
+}
+
+//! Batched queries agree with single queries, in any order
+TEST_CASE("history batch", "[mechanization][history]") {
+  StateHistory<Wgs84> history(32);
+  const std::vector<StatePvaSO3> states = fill(history, 50, 0.01);
+  const double t0 = history.oldest_time();
+  const double t1 = history.newest_time();
+
+  std::vector<double> times;
+  for (int i = 0; i <= 200; ++i) times.push_back(t0 + (t1 - t0) * i / 200.0);
+  times.push_back(t0 + 0.3 * (t1 - t0));  // out of order
+  times.push_back(states[22].time);       // epochs, jumping forward
+  times.push_back(states[47].time);
+  times.push_back(t1 + 1.0);  // out of range
+  std::vector<StatePvaSO3> batch(times.size());
+  REQUIRE(history.at(times.data(), times.size(), batch.data()) ==
+          times.size() - 1);
+
+  for (std::size_t i = 0; i + 1 < times.size(); ++i) {
+    StatePvaSO3 single;
+    REQUIRE(history.at(times[i], single));
+    REQUIRE(batch[i].position == single.position);
+    REQUIRE(batch[i].attitude == single.attitude);
+  }
+  const std::size_t n = times.size();
+  REQUIRE(batch[n - 3].position == states[22].position);
+  REQUIRE(batch[n - 2].attitude == states[47].attitude);
+  REQUIRE(std::isnan(batch.back().position[0]));
+}
@@ -0,0 +1,264 @@
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "landmarks.hpp"
+#include "local_frame.hpp"
+#include "pipeline.hpp"
+#include "stages.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::LocalAxes;
+using ennui::geodetic::LocalFrame;
+using ennui::geodetic::position_geodetic_to_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+using ennui::pipeline::Block;
+using ennui::pipeline::CalibratedMechanize;
+using ennui::pipeline::Channel;
+using ennui::pipeline::GeodeticToEcef;
+using ennui::pipeline::Gravitation;
+using ennui::pipeline::ImuBlock;
+using ennui::pipeline::Mechanize;
+using ennui::pipeline::Pipeline;
+using ennui::pipeline::StateBlock;
+using ennui::pipeline::ToLocalFrame;
+using ennui::pipeline::Vector3Block;
+
+static const std::size_t N = 64;
+
+//! Source generating count synthetic samples, block by block
+struct SampleSource {
+  std::size_t count;
+  std::size_t next = 0;
+  std::size_t blocks = 0;
+
+  explicit SampleSource(std::size_t n) : count(n) {}
+
+  template <std::size_t M>
+  bool operator()(ImuBlock<M> &block) {
+    while (block.size < M && next < count) {
+      block[block.size++] = synthetic_imu_sample(next++, 0.01);
+    }
+    ++blocks;
+    return next < count;
+  }
+};
+
+/**
+ * Sink collecting every state. It may run on a pipeline thread, where Catch2
+ * assertions are not allowed, so it only records what the test checks later.
+ */
+struct StateSink {
+  std::vector<StatePvaSO3> states;
+  std::size_t blocks = 0;
+  bool saw_last = false;
+  //! Blocks received after the one flagged last
+  std::size_t after_last = 0;
+
+  template <std::size_t M>
+  void operator()(const StateBlock<M> &block) {
+    if (saw_last) ++after_last;
+    states.insert(states.end(), block.items, block.items + block.size);
+    saw_last = block.last;
+    ++blocks;
+  }
+};
+
+//! Serial reference: fwd_pva_S03_rt loop and local-frame conversion
+static std::vector<StatePvaSO3> reference(std::size_t count,
+                                          const LocalFrame<Wgs84> &frame) {
+  std::vector<StatePvaSO3> states;
+  StatePvaSO3 state = landmark_start_state();
+  for (std::size_t k = 0; k < count; ++k) {
+    fwd_pva_S03_rt<Wgs84>(state, gravitation_ecef<Wgs84>(state.position),
+                          synthetic_imu_sample(k, 0.01), state);
+    states.push_back(StatePvaSO3{state.time,
+                                 frame.position_from_ecef(state.position),
+                                 frame.velocity_from_ecef(state.velocity),
+                                 frame.attitude_from_ecef(state.attitude)});
+  }
+  return states;
+}
+
+static void require_same(const std::vector<StatePvaSO3> &actual,
+                         const std::vector<StatePvaSO3> &expected) {
+  REQUIRE(actual.size() == expected.size());
+  for (std::size_t i = 0; i < actual.size(); ++i) {
+    REQUIRE(actual[i].time == expected[i].time);
+    REQUIRE(actual[i].position == expected[i].position);
+    REQUIRE(actual[i].velocity == expected[i].velocity);
+    REQUIRE(actual[i].attitude == expected[i].attitude);
+  }
+}
+
+//! A stage per thread reproduces the serial loop bitwise
+TEST_CASE("pipeline threaded", "[pipeline]") {
+  const LocalFrame<Wgs84> frame(WhiteHouse_LLH, LocalAxes::NED);
+  const std::size_t count = 1000;  // not a multiple of the block size
+  const std::vector<StatePvaSO3> expected = reference(count, frame);
+
+  SampleSource source(count);
+  Mechanize<Wgs84> mechanize(landmark_start_state());
+  ToLocalFrame<Wgs84> to_local(frame);
+  StateSink sink;
+  {
+    Pipeline pipeline;
+    // Two blocks per channel: the source is throttled by the stages
+    auto &samples = pipeline.channel<ImuBlock<N>>(2);
+    auto &ecef = pipeline.channel<StateBlock<N>>(2);
+    auto &local = pipeline.channel<StateBlock<N>>(2);
+    pipeline.source(source, samples);
+    pipeline.stage(mechanize, samples, ecef);
+    pipeline.stage(to_local, ecef, local);
+    pipeline.sink(sink, local);
+    pipeline.join();
+  }
+  REQUIRE(sink.saw_last);
+  REQUIRE(sink.after_last == 0);
+  REQUIRE(sink.blocks == (count + N - 1) / N);
+  REQUIRE(source.blocks == sink.blocks);
+  require_same(sink.states, expected);
+  REQUIRE(mechanize.state().time == expected.back().time);
+}
+
+//! Fused stages on the calling thread give the same result
+TEST_CASE("pipeline serial chain", "[pipeline]") {
+  const LocalFrame<Wgs84> frame(WhiteHouse_LLH);
+  const std::size_t count = 3 * N;  // exact multiple: full last block
+  const std::vector<StatePvaSO3> expected = reference(count, frame);
+
+  SampleSource source(count);
+  Mechanize<Wgs84> mechanize(landmark_start_state());
+  ToLocalFrame<Wgs84> to_local(frame);
+  auto fused = ennui::pipeline::chain<StateBlock<N>>(mechanize, to_local);
+  StateSink sink;
+  ennui::pipeline::run_serial<ImuBlock<N>, StateBlock<N>>(source, fused,
+                                                          sink);
+  REQUIRE(sink.saw_last);
+  REQUIRE(sink.after_last == 0);
+  REQUIRE(sink.blocks == count / N);  // the last block is full and flagged
+  require_same(sink.states, expected);
+}
+
+//! Calibrated stage with an identity calibration matches Mechanize
+TEST_CASE("pipeline calibrated mechanization", "[pipeline]") {
+  SampleSource source(2 * N + 5);
+  ImuBlock<N> samples;
+  StateBlock<N> plain, calibrated;
+  Mechanize<Wgs84> mechanize(landmark_start_state());
+  CalibratedMechanize<Wgs84> calibrated_mechanize(
+      landmark_start_state(), ennui::mechanization::ImuCalibration());
+  bool more = true;
+  while (more) {
+    samples.size = 0;
+    more = source(samples);
+    mechanize(samples, plain);
+    calibrated_mechanize(samples, calibrated);
+    REQUIRE(calibrated.size == samples.size);
+    for (std::size_t i = 0; i < samples.size; ++i) {
+      REQUIRE(calibrated[i].position == plain[i].position);
+      REQUIRE(calibrated[i].attitude == plain[i].attitude);
+    }
+  }
+  REQUIRE(calibrated_mechanize.state().time == mechanize.state().time);
+}
+
+//! Geodetic and gravitation stages wrap the model functions
+TEST_CASE("pipeline geodetic stages", "[pipeline]") {
+  Vector3Block<N> llh, ecef, gravitation;
+  llh[0] = WhiteHouse_LLH;
+  llh[1] = Vector3{-33.9, 151.2, 50.0};
+  llh[2] = Vector3{89.9, -120.0, 1000.0};
+  llh.size = 3;
+  GeodeticToEcef<Wgs84>()(llh, ecef);
+  Gravitation<Wgs84>()(ecef, gravitation);
+  REQUIRE(ecef.size == 3);
+  REQUIRE(gravitation.size == 3);
+  for (std::size_t i = 0; i < 3; ++i) {
+    REQUIRE(ecef[i] == position_geodetic_to_ecef<Wgs84>(llh[i]));
+    REQUIRE(gravitation[i] == gravitation_ecef<Wgs84>(ecef[i]));
+  }
+}
+
+//! A full channel holds the producer back until the consumer releases
+TEST_CASE("pipeline backpressure", "[pipeline]") {
+  typedef Block<int, 4> IntBlock;
+  Channel<IntBlock> channel(2);
+  std::atomic<int> produced(0);
+  std::thread producer([&]() {
+    for (int i = 0; i < 3; ++i) {
+      IntBlock *block = channel.acquire();
+      block->items[0] = i;
+      block->size = 1;
+      block->last = (i == 2);
+      channel.push(block);
+      produced.store(i + 1);
+    }
+  });
+  while (produced.load() < 2) std::this_thread::yield();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  REQUIRE(produced.load() == 2);  // both blocks in flight
+
+  for (int i = 0; i < 3; ++i) {
+    IntBlock *block = channel.pop();
+    REQUIRE(block->items[0] == i);
+    REQUIRE(block->last == (i == 2));
+    channel.release(block);
+  }
+  producer.join();
+  REQUIRE(produced.load() == 3);
+}
+
+//! Stage-per-thread throughput against the serial chain
+TEST_CASE("pipeline throughput", "[.][bench][pipeline]") {
+  typedef ImuBlock<256> In;
+  typedef StateBlock<256> Out;
+  const LocalFrame<Wgs84> frame(WhiteHouse_LLH);
+  const std::size_t count = 1000000;
+
+  double serial_seconds, threaded_seconds;
+  {
+    SampleSource source(count);
+    Mechanize<Wgs84> mechanize(landmark_start_state());
+    ToLocalFrame<Wgs84> to_local(frame);
+    auto fused = ennui::pipeline::chain<Out>(mechanize, to_local);
+    StateSink sink;
+    const auto t0 = std::chrono::steady_clock::now();
+    ennui::pipeline::run_serial<In, Out>(source, fused, sink);
+    serial_seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - t0)
+                         .count();
+  }
+  {
+    SampleSource source(count);
+    Mechanize<Wgs84> mechanize(landmark_start_state());
+    ToLocalFrame<Wgs84> to_local(frame);
+    StateSink sink;
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+      Pipeline pipeline;
+      auto &samples = pipeline.channel<In>();
+      auto &ecef = pipeline.channel<Out>();
+      auto &local = pipeline.channel<Out>();
+      pipeline.source(source, samples);
+      pipeline.stage(mechanize, samples, ecef);
+      pipeline.stage(to_local, ecef, local);
+      pipeline.sink(sink, local);
+    }
+    threaded_seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - t0)
+                           .count();
+  }
+  std::cout << "Pipeline, " << count << " samples: serial "
+            << count / serial_seconds << " samples/s, threaded "
+            << count / threaded_seconds << " samples/s on "
+            << std::thread::hardware_concurrency() << " cores" << std::endl;
+}
@@ -0,0 +1,10 @@
+/**
+ * @file malloc_counter.hpp
+ * @brief Heap-activity counter backed by a malloc/operator new interposer.
+ */
+
+#pragma once
+#include <cstddef>
+
+//! Number of heap allocations (malloc, calloc, realloc, new) since start-up
+std::size_t heap_allocations();
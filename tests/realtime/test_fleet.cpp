@@ -0,0 +1,250 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ecef.hpp"
+#include "fleet_scheduler.hpp"
+#include "gravitation.hpp"
+#include "landmarks.hpp"
+#include "mpmc_queue.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+using ennui::realtime::FleetConfig;
+using ennui::realtime::FleetReport;
+using ennui::realtime::FleetScheduler;
+using ennui::realtime::MpmcQueue;
+using ennui::realtime::PublishedState;
+
+/**
+ * @brief Synthetic packet generator for a fleet of vehicles
+ *
+ * Vehicles start at the landmark priors, offset so that no two are alike, and
+ * receive deterministic IMU samples with a vehicle-dependent phase.
+ */
+struct SyntheticFleet {
+  explicit SyntheticFleet(std::size_t vehicles, double dt = 1e-2) : dt(dt) {
+    const prop_mean *landmarks[] = {&WhiteHouse_mean_prop,
+                                    &SydneyOpera_mean_prop,
+                                    &AconcaguaPeak_mean_prop};
+    for (std::size_t v = 0; v < vehicles; ++v) {
+      const state_pva_SO3 &s = landmarks[v % 3]->prior;
+      initial.push_back(StatePvaSO3{0.0, s.position + Vector3{1.0 * v, 0, 0},
+                                    s.velocity, s.attitude});
+    }
+  }
+
+  ImuSample sample(std::size_t vehicle, std::uint64_t k) const {
+    const double t = k * dt;
+    const double phase = 0.1 * vehicle;
+    return ImuSample{
+        t + dt, dt, Vector3{0.1 * sin(0.5 * t + phase), -0.2, 9.81},
+        Vector3{1e-3 * cos(0.3 * t + phase), 2e-3, -1e-3 * sin(0.7 * t)}};
+  }
+
+  //! Serial reference: vehicle after n samples
+  StatePvaSO3 expected(std::size_t vehicle, std::uint64_t n) const {
+    StatePvaSO3 state = initial[vehicle];
+    for (std::uint64_t k = 0; k < n; ++k) {
+      fwd_pva_S03_rt<Wgs84>(state, gravitation_ecef<Wgs84>(state.position),
+                            sample(vehicle, k), state);
+    }
+    return state;
+  }
+
+  double dt;
+  std::vector<StatePvaSO3> initial;
+};
+
+static void require_state(const PublishedState &actual, std::uint64_t count,
+                          const StatePvaSO3 &expected) {
+  REQUIRE(actual.sample_count == count);
+  REQUIRE(actual.state.time == expected.time);
+  REQUIRE(actual.state.position == expected.position);
+  REQUIRE(actual.state.velocity == expected.velocity);
+  REQUIRE(actual.state.attitude == expected.attitude);
+}
+
+//! Every pushed element is popped exactly once, across threads
+TEST_CASE("mpmc queue", "[realtime][fleet]") {
+  MpmcQueue<std::uint64_t> queue(100);
+  REQUIRE(queue.capacity() == 128);
+  for (std::uint64_t i = 0; i < 128; ++i) REQUIRE(queue.try_push(i));
+  REQUIRE_FALSE(queue.try_push(0));
+  std::uint64_t value;
+  for (std::uint64_t i = 0; i < 128; ++i) {
+    REQUIRE(queue.try_pop(value));
+    REQUIRE(value == i);
+  }
+  REQUIRE_FALSE(queue.try_pop(value));
+
+  const std::uint64_t n = 50000;
+  std::atomic<std::uint64_t> sum(0), popped(0);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < 2; ++p) {
+    threads.emplace_back([&, p]() {
+      for (std::uint64_t i = 1 + p; i <= n; i += 2) {
+        while (!queue.try_push(i)) std::this_thread::yield();
+      }
+    });
+    threads.emplace_back([&]() {
+      std::uint64_t v;
+      while (popped.load() < n) {
+        if (queue.try_pop(v)) {
+          sum += v;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (std::thread &t : threads) t.join();
+  REQUIRE(sum.load() == n * (n + 1) / 2);
+}
+
+//! Interleaved packets, driven from the test thread: per-vehicle order holds
+TEST_CASE("fleet manual", "[realtime][fleet]") {
+  const std::size_t vehicles = 16;
+  const std::uint64_t n = 100;
+  SyntheticFleet fleet(vehicles);
+  FleetConfig config;
+  config.workers = 0;
+  config.batch_vehicles = 5;
+  config.max_steps_per_vehicle = 7;
+  FleetScheduler<Wgs84, 128> scheduler(fleet.initial, config);
+
+  for (std::uint64_t k = 0; k < n; ++k) {
+    for (std::size_t v = 0; v < vehicles; ++v) {
+      REQUIRE(scheduler.submit(v, fleet.sample(v, k)));
+    }
+    if (k % 3 == 0) scheduler.run_once();
+  }
+  while (scheduler.run_once() > 0) {
+  }
+
+  for (std::size_t v = 0; v < vehicles; ++v) {
+    require_state(scheduler.latest(v), n, fleet.expected(v, n));
+  }
+  const FleetReport report = scheduler.report();
+  REQUIRE(report.steps == vehicles * n);
+  REQUIRE(report.latency.count() == vehicles * n);
+  REQUIRE(report.dropped == 0);
+}
+
+//! Full inboxes reject packets instead of blocking the producer
+TEST_CASE("fleet dropped", "[realtime][fleet]") {
+  SyntheticFleet fleet(2);
+  FleetConfig config;
+  config.workers = 0;
+  FleetScheduler<Wgs84, 4> scheduler(fleet.initial, config);
+  std::size_t accepted = 0;
+  for (std::uint64_t k = 0; k < 10; ++k) {
+    accepted += scheduler.submit(1, fleet.sample(1, k)) ? 1 : 0;
+  }
+  REQUIRE(accepted == 4);
+  REQUIRE(scheduler.report().dropped == 6);
+  while (scheduler.run_once() > 0) {
+  }
+  require_state(scheduler.latest(1), 4, fleet.expected(1, 4));
+  require_state(scheduler.latest(0), 0, fleet.initial[0]);
+}
+
+//! Limits that would never process a packet are rejected
+TEST_CASE("fleet config", "[realtime][fleet]") {
+  SyntheticFleet fleet(2);
+  FleetConfig config;
+  config.workers = 0;
+  config.batch_vehicles = 0;
+  REQUIRE_THROWS_AS(FleetScheduler<Wgs84>(fleet.initial, config),
+                    std::invalid_argument);
+  config.batch_vehicles = 1;
+  config.max_steps_per_vehicle = 0;
+  REQUIRE_THROWS_AS(FleetScheduler<Wgs84>(fleet.initial, config),
+                    std::invalid_argument);
+}
+
+//! Worker pool with concurrent producers reproduces serial propagation
+TEST_CASE("fleet threaded", "[realtime][fleet]") {
+  const std::size_t vehicles = 64;
+  const std::uint64_t n = 200;
+  SyntheticFleet fleet(vehicles);
+  FleetConfig config;
+  config.workers = 2;
+  config.batch_vehicles = 8;
+  config.max_steps_per_vehicle = 16;
+  FleetScheduler<Wgs84> scheduler(fleet.initial, config);
+  scheduler.start();
+
+  // Each producer owns half of the vehicles
+  std::vector<std::thread> producers;
+  for (std::size_t p = 0; p < 2; ++p) {
+    producers.emplace_back([&, p]() {
+      for (std::uint64_t k = 0; k < n; ++k) {
+        for (std::size_t v = p; v < vehicles; v += 2) {
+          while (!scheduler.submit(v, fleet.sample(v, k))) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+  for (std::thread &t : producers) t.join();
+  for (std::size_t v = 0; v < vehicles; ++v) {
+    while (scheduler.latest(v).sample_count < n) std::this_thread::yield();
+  }
+  scheduler.stop();
+
+  for (std::size_t v = 0; v < vehicles; ++v) {
+    require_state(scheduler.latest(v), n, fleet.expected(v, n));
+  }
+  const FleetReport report = scheduler.report();
+  REQUIRE(report.steps == vehicles * n);
+}
+
+//! Throughput and queueing latency under a synthetic fleet load
+TEST_CASE("fleet throughput", "[.][bench][realtime][fleet]") {
+  const std::size_t vehicles = 4096;
+  const std::uint64_t n = 200;
+  const unsigned cores = std::thread::hardware_concurrency();
+  SyntheticFleet fleet(vehicles);
+  FleetConfig config;
+  config.workers = cores > 1 ? cores - 1 : 1;
+  FleetScheduler<Wgs84> scheduler(fleet.initial, config);
+  scheduler.start();
+  for (std::uint64_t k = 0; k < n; ++k) {
+    for (std::size_t v = 0; v < vehicles; ++v) {
+      while (!scheduler.submit(v, fleet.sample(v, k))) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  for (std::size_t v = 0; v < vehicles; ++v) {
+    while (scheduler.latest(v).sample_count < n) std::this_thread::yield();
+  }
+  scheduler.stop();
+
+  const FleetReport report = scheduler.report();
+  REQUIRE(report.steps == vehicles * n);
+  std::cout << "Fleet of " << vehicles << " vehicles, " << config.workers
+            << " workers (" << report.pinned << " pinned): " << report.steps
+            << " steps in " << report.seconds << " s ("
+            << report.steps_per_second() << " steps/s), "
+            << report.steps / double(report.batches) << " steps/batch"
+            << std::endl;
+  std::cout << "   submit-to-publish latency [ns] p50: "
+            << report.latency.percentile(0.5)
+            << " p99: " << report.latency.percentile(0.99)
+            << " p99.9: " << report.latency.percentile(0.999)
+            << " max: " << report.latency.max() << std::endl;
+}
@@ -0,0 +1,203 @@
+/**
+ * Real-time safety checks. Built as a separate executable with
+ * EIGEN_RUNTIME_NO_MALLOC and a malloc interposer (malloc_counter.cpp), so any
+ * heap activity on the propagation path is either asserted by Eigen or counted.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "imu_calibration.hpp"
+#include "imu_ingest.hpp"
+#include "landmarks.hpp"
+#include "latency_histogram.hpp"
+#include "malloc_counter.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+#error "test_noalloc.cpp must be compiled with EIGEN_RUNTIME_NO_MALLOC"
+#endif
+
+using ennui::ImuSample;
+using ennui::Matrix3x3;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::gravitation_ecef;
+using ennui::geodetic::Wgs84;
+using ennui::mechanization::ecef::fwd_pva_S03;
+using ennui::mechanization::ecef::fwd_pva_S03_rt;
+using ennui::realtime::LatencyHistogram;
+
+//! Deterministic sample sweeping both small-angle branches
+static ImuSample sample_at(std::uint64_t k) {
+  const double dt = 1e-3;
+  const double t = k * dt;
+  const double gyro = (k % 2) ? 1e-9 : 0.5;
+  return ImuSample{t + dt, dt, Vector3{0.3 * sin(t), -0.1, 9.8},
+                   Vector3{gyro, -0.5 * gyro, 0.2 * gyro * cos(t)}};
+}
+
+//! Scoped guard: Eigen asserts on malloc and heap activity is counted
+class NoMallocScope {
+ public:
+  NoMallocScope() : start_(heap_allocations()) {
+    Eigen::internal::set_is_malloc_allowed(false);
+  }
+  ~NoMallocScope() { Eigen::internal::set_is_malloc_allowed(true); }
+  std::size_t allocations() const { return heap_allocations() - start_; }
+
+ private:
+  std::size_t start_;
+};
+
+//! The interposer must see ordinary heap activity, or the checks prove nothing
+TEST_CASE("interposer sees heap activity", "[noalloc]") {
+  const std::size_t before = heap_allocations();
+  std::unique_ptr<std::vector<double>> v(new std::vector<double>(100));
+  REQUIRE(heap_allocations() - before >= 2);
+}
+
+//! Real-time entry point reproduces the reference result
+TEST_CASE("rt propagation landmark", "[noalloc]") {
+  auto tolerance = 1e-15;
+  const prop_mean &pm = WhiteHouse_mean_prop;
+  const Vector3 gamma = gravitation_ecef<Wgs84>(pm.prior.position);
+  Vector3 position, velocity;
+  Matrix3x3 attitude;
+  fwd_pva_S03_rt<Wgs84>(pm.prior.position, pm.prior.velocity,
+                        pm.prior.attitude, gamma, pm.specific_force,
+                        pm.angular_rate, pm.dt, position, velocity, attitude);
+  REQUIRE_REL(position, pm.posterior.position, tolerance);
+  REQUIRE_REL(velocity, pm.posterior.velocity, tolerance);
+  REQUIRE_REL(attitude.reshaped(), pm.posterior.attitude.reshaped(),
+              tolerance);
+}
+
+//! Zero heap activity over many real-time steps, including in-place updates
+TEST_CASE("rt propagation allocation-free", "[noalloc]") {
+  StatePvaSO3 state = landmark_start_state();
+  std::size_t allocations = 0;
+  {
+    NoMallocScope scope;
+    for (std::uint64_t k = 0; k < 100000; ++k) {
+      const Vector3 gamma = gravitation_ecef<Wgs84>(state.position);
+      fwd_pva_S03_rt<Wgs84>(state, gamma, sample_at(k), state);
+    }
+    allocations = scope.allocations();
+  }
+  REQUIRE(allocations == 0);
+  REQUIRE(state.position.allFinite());
+}
+
+//! Calibrated step, including bias updates between steps, is allocation-free
+TEST_CASE("calibrated propagation allocation-free", "[noalloc]") {
+  Matrix3x3 M = 1e-3 * Matrix3x3::Ones();
+  ennui::mechanization::ImuCalibration calibration(M, -M);
+  ennui::mechanization::ImuBias bias;
+  StatePvaSO3 state = landmark_start_state();
+  std::size_t allocations = 0;
+  {
+    NoMallocScope scope;
+    for (std::uint64_t k = 0; k < 10000; ++k) {
+      bias.gyro[0] = 1e-6 * k;
+      calibration.set_bias(bias);
+      const Vector3 gamma = gravitation_ecef<Wgs84>(state.position);
+      fwd_pva_S03_rt<Wgs84>(state, gamma, sample_at(k), calibration, state);
+    }
+    allocations = scope.allocations();
+  }
+  REQUIRE(allocations == 0);
+  REQUIRE(state.position.allFinite());
+}
+
+//! Ref-based entry point with strided, mismatched-layout arguments
+TEST_CASE("ref propagation with strided arguments", "[noalloc]") {
+  // Columns of a 3xN block and a transposed attitude force Ref conversions
+  Eigen::Matrix<double, 3, 4> columns;
+  Eigen::Matrix<double, 4, 3> rows;
+  Eigen::Matrix<double, 3, 3, Eigen::RowMajor> attitude_rm;
+  const StatePvaSO3 prior = landmark_start_state();
+  columns.col(0) = prior.position;
+  columns.col(1) = prior.velocity;
+  rows.row(0) = gravitation_ecef<Wgs84>(prior.position).transpose();
+  attitude_rm = prior.attitude;
+  const ImuSample s = sample_at(0);
+
+  Vector3 position, velocity;
+  Matrix3x3 attitude;
+  std::size_t allocations = 0;
+  {
+    NoMallocScope scope;
+    fwd_pva_S03<Wgs84>(columns.col(0), columns.col(1), attitude_rm,
+                       rows.row(0).transpose(), s.specific_force,
+                       s.angular_rate, s.dt, position, velocity, attitude);
+    allocations = scope.allocations();
+  }
+  REQUIRE(allocations == 0);
+
+  StatePvaSO3 expected;
+  fwd_pva_S03_rt<Wgs84>(prior, gravitation_ecef<Wgs84>(prior.position), s,
+                        expected);
+  REQUIRE(position == expected.position);
+  REQUIRE(velocity == expected.velocity);
+  REQUIRE(attitude == expected.attitude);
+}
+
+//! Ingest consumer path (ring, propagation, seqlock) is allocation-free
+TEST_CASE("ingest allocation-free", "[noalloc]") {
+  typedef ennui::realtime::ImuIngest<Wgs84, 256, 32> Ingest;
+  std::unique_ptr<Ingest> ingest(new Ingest(landmark_start_state()));
+  std::size_t allocations = 0;
+  {
+    NoMallocScope scope;
+    for (std::uint64_t k = 0; k < 10000; ++k) {
+      ingest->push(sample_at(k));
+      if (k % 16 == 15) ingest->drain();
+    }
+    while (ingest->drain() > 0) {
+    }
+    allocations = scope.allocations();
+  }
+  REQUIRE(allocations == 0);
+  REQUIRE(ingest->latest().sample_count == 10000);
+}
+
+/**
+ * Per-step latency of the real-time entry point over millions of steps.
+ * Hidden by default, run with: Ennui_test_noalloc "[latency]"
+ */
+TEST_CASE("rt propagation latency histogram", "[.][latency][noalloc]") {
+  typedef std::chrono::steady_clock Clock;
+  const std::uint64_t n = 5000000;
+  StatePvaSO3 state = landmark_start_state();
+  LatencyHistogram latency;
+  std::size_t allocations = 0;
+  {
+    NoMallocScope scope;
+    for (std::uint64_t k = 0; k < n; ++k) {
+      const ImuSample s = sample_at(k);
+      const Clock::time_point start = Clock::now();
+      const Vector3 gamma = gravitation_ecef<Wgs84>(state.position);
+      fwd_pva_S03_rt<Wgs84>(state, gamma, s, state);
+      const Clock::time_point stop = Clock::now();
+      latency.record(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+              .count());
+    }
+    allocations = scope.allocations();
+  }
+  REQUIRE(allocations == 0);
+  REQUIRE(latency.count() == n);
+  std::cout << "Real-time step (gravitation + fwd_pva_S03_rt), " << n
+            << " steps, mean " << latency.mean() << " ns" << std::endl;
+  std::cout << "   per-step latency [ns] p50: " << latency.percentile(0.5)
+            << " p99: " << latency.percentile(0.99)
+            << " p99.9: " << latency.percentile(0.999)
+            << " max: " << latency.max() << std::endl;
+}
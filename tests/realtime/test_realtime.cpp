@@ -0,0 +1,259 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ecef.hpp"
+#include "gravitation.hpp"
+#include "imu_ingest.hpp"
+#include "landmarks.hpp"
+#include "latency_histogram.hpp"
+#include "seqlock.hpp"
+#include "spsc_ring.hpp"
+#include "test_utils.hpp"
+#include "wgs84.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::geodetic::Wgs84;
+using ennui::realtime::ImuIngest;
+using ennui::realtime::LatencyHistogram;
+using ennui::realtime::PublishedState;
+using ennui::realtime::SeqLock;
+using ennui::realtime::SpscRing;
+
+//! Landmark prior as an ennui state
+static StatePvaSO3 to_state(const state_pva_SO3 &s) {
+  return StatePvaSO3{0.0, s.position, s.velocity, s.attitude};
+}
+
+//! Deterministic, gently varying IMU sample
+static ImuSample synthetic_sample(std::uint64_t k, double dt) {
+  const double t = k * dt;
+  return ImuSample{t + dt, dt,
+                   Vector3{0.1 * sin(0.5 * t), -0.2, 9.81 + 0.05 * cos(t)},
+                   Vector3{1e-3 * cos(0.3 * t), 2e-3, -1e-3 * sin(0.7 * t)}};
+}
+
+//! Ring preserves FIFO order across wrap-around and reports full/empty
+TEST_CASE("spsc ring single thread", "[realtime]") {
+  SpscRing<int, 4> ring;
+  int value = -1;
+  REQUIRE_FALSE(ring.try_pop(value));
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) REQUIRE(ring.try_push(10 * round + i));
+    REQUIRE_FALSE(ring.try_push(99));
+    REQUIRE(ring.size() == 4);
+
+    REQUIRE(ring.try_pop(value));
+    REQUIRE(value == 10 * round);
+    int batch[8];
+    REQUIRE(ring.pop_batch(batch, 8) == 3);
+    for (int i = 0; i < 3; ++i) REQUIRE(batch[i] == 10 * round + i + 1);
+    REQUIRE(ring.size() == 0);
+  }
+}
+
+//! Ring delivers every element exactly once, in order, across threads
+TEST_CASE("spsc ring two threads", "[realtime]") {
+  const std::uint64_t n = 1000000;
+  std::unique_ptr<SpscRing<std::uint64_t, 256>> ring(
+      new SpscRing<std::uint64_t, 256>());
+  REQUIRE(reinterpret_cast<std::uintptr_t>(ring.get()) %
+              ennui::realtime::CACHE_LINE_SIZE ==
+          0);
+
+  std::thread producer([&]() {
+    for (std::uint64_t i = 0; i < n;) {
+      if (ring->try_push(i)) ++i;
+    }
+  });
+
+  std::uint64_t expected = 0;
+  bool in_order = true;
+  std::uint64_t batch[32];
+  while (expected < n) {
+    const std::size_t count = ring->pop_batch(batch, 32);
+    for (std::size_t i = 0; i < count; ++i) {
+      in_order = in_order && (batch[i] == expected);
+      ++expected;
+    }
+  }
+  producer.join();
+  REQUIRE(in_order);
+  REQUIRE(expected == n);
+}
+
+//! Readers never observe a partially written value
+TEST_CASE("seqlock consistency", "[realtime]") {
+  struct Block {
+    double values[16];
+  };
+  Block initial;
+  for (int i = 0; i < 16; ++i) initial.values[i] = 0.0;
+  SeqLock<Block> lock(initial);
+  std::atomic<bool> stop(false);
+
+  std::thread writer([&]() {
+    Block b;
+    for (int k = 1; k <= 200000; ++k) {
+      for (int i = 0; i < 16; ++i) b.values[i] = k;
+      lock.store(b);
+    }
+    stop.store(true);
+  });
+
+  bool consistent = true;
+  std::uint64_t reads = 0;
+  while (!stop.load()) {
+    const Block b = lock.load();
+    for (int i = 1; i < 16; ++i) consistent &= (b.values[i] == b.values[0]);
+    ++reads;
+  }
+  writer.join();
+  REQUIRE(consistent);
+  REQUIRE(lock.version() == 200000);
+  REQUIRE(lock.load().values[15] == 200000.0);
+  std::cout << "Seqlock reads during writes: " << reads << std::endl;
+}
+
+//! Single-sample ingest reproduces the reference propagation
+TEST_CASE("ingest landmark", "[realtime]") {
+  auto tolerance = 1e-15;
+  const prop_mean &pm = WhiteHouse_mean_prop;
+  std::unique_ptr<ImuIngest<Wgs84>> ingest(
+      new ImuIngest<Wgs84>(to_state(pm.prior)));
+  REQUIRE(reinterpret_cast<std::uintptr_t>(ingest.get()) %
+              ennui::realtime::CACHE_LINE_SIZE ==
+          0);
+
+  REQUIRE(ingest->push(
+      ImuSample{pm.dt, pm.dt, pm.specific_force, pm.angular_rate}));
+  REQUIRE(ingest->drain() == 1);
+  REQUIRE(ingest->drain() == 0);
+
+  const PublishedState published = ingest->latest();
+  REQUIRE(published.sample_count == 1);
+  REQUIRE(published.state.time == pm.dt);
+  REQUIRE_REL(published.state.position, pm.posterior.position, tolerance);
+  REQUIRE_REL(published.state.velocity, pm.posterior.velocity, tolerance);
+  REQUIRE_REL(published.state.attitude.reshaped(),
+              pm.posterior.attitude.reshaped(), tolerance);
+}
+
+//! Threaded ingest is bit-identical to serial propagation
+TEST_CASE("ingest threaded", "[realtime]") {
+  using ennui::geodetic::gravitation_ecef;
+  using ennui::mechanization::ecef::fwd_pva_S03;
+  const std::uint64_t n = 20000;
+  const double dt = 1e-2;
+  const StatePvaSO3 initial = to_state(WhiteHouse_mean_prop.prior);
+
+  // Serial reference
+  StatePvaSO3 expected = initial;
+  for (std::uint64_t k = 0; k < n; ++k) {
+    const ImuSample s = synthetic_sample(k, dt);
+    const Vector3 gamma = gravitation_ecef<Wgs84>(expected.position);
+    StatePvaSO3 next;
+    fwd_pva_S03<Wgs84>(expected.position, expected.velocity,
+                       expected.attitude, gamma, s.specific_force,
+                       s.angular_rate, s.dt, next.position, next.velocity,
+                       next.attitude);
+    next.time = s.time;
+    expected = next;
+  }
+
+  std::unique_ptr<ImuIngest<Wgs84, 64, 16>> ingest(
+      new ImuIngest<Wgs84, 64, 16>(initial));
+  std::atomic<bool> stop(false);
+  std::thread consumer([&]() { ingest->run(stop); });
+  for (std::uint64_t k = 0; k < n;) {
+    if (ingest->push(synthetic_sample(k, dt))) {
+      ++k;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  stop.store(true);
+  consumer.join();
+
+  const PublishedState published = ingest->latest();
+  REQUIRE(published.sample_count == n);
+  REQUIRE(published.state.time == expected.time);
+  REQUIRE(published.state.position == expected.position);
+  REQUIRE(published.state.velocity == expected.velocity);
+  REQUIRE(published.state.attitude == expected.attitude);
+}
+
+//! Percentiles fall within the histogram's quantization error
+TEST_CASE("latency histogram", "[realtime]") {
+  LatencyHistogram h;
+  for (std::uint64_t ns = 1; ns <= 100000; ++ns) h.record(ns);
+  REQUIRE(h.count() == 100000);
+  REQUIRE(h.max() == 100000);
+  const double rel = 1.0 / (1 << LatencyHistogram::SUB_BITS);
+  REQUIRE(std::abs(h.percentile(0.5) - 50000.0) <= rel * 50000.0);
+  REQUIRE(std::abs(h.percentile(0.99) - 99000.0) <= rel * 99000.0);
+  REQUIRE(h.percentile(1.0) == 100000);
+  REQUIRE(h.percentile(0.0) == 1);
+}
+
+/**
+ * Stress test: push-to-publish latency of the ingest with the producer paced at
+ * a fixed sample rate. Hidden by default, run with: Ennui_test "[stress]"
+ */
+TEST_CASE("ingest latency stress", "[.][stress][realtime]") {
+  typedef std::chrono::steady_clock Clock;
+  const std::uint64_t n = 200000;
+  const double dt = 1e-3;
+  const std::chrono::microseconds period(25);
+  std::unique_ptr<ImuIngest<Wgs84>> ingest(
+      new ImuIngest<Wgs84>(to_state(WhiteHouse_mean_prop.prior)));
+  std::vector<Clock::time_point> pushed(n);
+  std::atomic<bool> stop(false);
+
+  LatencyHistogram latency;
+  std::thread consumer([&]() {
+    std::uint64_t done = 0;
+    for (;;) {
+      if (ingest->drain() == 0) {
+        if (stop.load() && done == n) return;
+        std::this_thread::yield();
+        continue;
+      }
+      const std::uint64_t count = ingest->latest().sample_count;
+      const Clock::time_point now = Clock::now();
+      for (; done < count; ++done) {
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           now - pushed[done])
+                           .count());
+      }
+    }
+  });
+
+  const Clock::time_point start = Clock::now();
+  Clock::time_point next = start;
+  for (std::uint64_t k = 0; k < n; ++k) {
+    while (Clock::now() < next) std::this_thread::yield();
+    next += period;
+    pushed[k] = Clock::now();
+    while (!ingest->push(synthetic_sample(k, dt))) std::this_thread::yield();
+  }
+  stop.store(true);
+  consumer.join();
+  const double elapsed =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  REQUIRE(latency.count() == n);
+  std::cout << "Ingest stress, " << n << " samples in " << elapsed << " s ("
+            << n / elapsed << " samples/s), full-ring retries: "
+            << ingest->dropped() << std::endl;
+  std::cout << "   push-to-publish latency [ns] p50: " << latency.percentile(0.5)
+            << " p99: " << latency.percentile(0.99)
+            << " p99.9: " << latency.percentile(0.999)
+            << " max: " << latency.max() << std::endl;
+}
@@ -0,0 +1,328 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kernels.hpp"
+#include "landmarks.hpp"
+#include "latency_histogram.hpp"
+#include "service_client.hpp"
+#include "service_server.hpp"
+#include "socket_io.hpp"
+#include "synthetic_imu.hpp"
+#include "test_utils.hpp"
+
+using ennui::ImuSample;
+using ennui::StatePvaSO3;
+using ennui::Vector3;
+using ennui::realtime::LatencyHistogram;
+using ennui::service::IMU_RECORD;
+using ennui::service::Op;
+using ennui::service::Response;
+using ennui::service::ServiceClient;
+using ennui::service::ServiceServer;
+using ennui::service::STATE_RECORD;
+using ennui::service::Status;
+
+static const std::size_t SEGMENT_BYTES = 1 << 22;
+
+static std::string test_socket_path() {
+  return "/tmp/ennui-test-" + std::to_string(::getpid()) + ".sock";
+}
+
+static sockaddr_un socket_address(const std::string &path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, path.c_str());
+  return address;
+}
+
+//! Server running on a background thread for the lifetime of the fixture
+struct RunningServer {
+  ServiceServer server;
+  std::thread thread;
+  RunningServer() : server(test_socket_path()) {
+    thread = std::thread([this]() { server.run(); });
+  }
+  ~RunningServer() {
+    server.stop();
+    thread.join();
+  }
+};
+
+static void require_same(const StatePvaSO3 &a, const StatePvaSO3 &b) {
+  REQUIRE(a.time == b.time);
+  REQUIRE(a.position == b.position);
+  REQUIRE(a.velocity == b.velocity);
+  REQUIRE(a.attitude == b.attitude);
+}
+
+//! Results through the service equal in-process kernel calls
+TEST_CASE("service propagate", "[service]") {
+  RunningServer running;
+  ServiceClient client(running.server.socket_path(), SEGMENT_BYTES);
+
+  const std::vector<ImuSample> samples = synthetic_imu_samples(1000, 0.01);
+  std::vector<StatePvaSO3> remote(samples.size()), local(samples.size());
+  client.propagate(landmark_start_state(), samples.data(), samples.size(),
+                   remote.data());
+  StatePvaSO3 state = landmark_start_state();
+  ennui::kernels::propagate(state, samples.data(), samples.size(),
+                            local.data());
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    require_same(remote[i], local[i]);
+  }
+}
+
+//! Batched gravitation and geodetic conversion
+TEST_CASE("service geodetic", "[service]") {
+  RunningServer running;
+  ServiceClient client(running.server.socket_path(), SEGMENT_BYTES);
+
+  std::vector<double> llh;
+  for (int i = 0; i < 100; ++i) {
+    llh.insert(llh.end(), {-89.0 + 1.78 * i, -179.0 + 3.5 * i, 10.0 * i});
+  }
+  const std::size_t n = llh.size() / 3;
+  std::vector<double> ecef(llh.size()), gravitation(llh.size());
+  std::vector<double> local_ecef(llh.size()), local_gravitation(llh.size());
+  client.position_geodetic_to_ecef(llh.data(), ecef.data(), n);
+  client.gravitation_ecef(ecef.data(), gravitation.data(), n);
+  ennui::kernels::position_geodetic_to_ecef(llh.data(), local_ecef.data(), n);
+  ennui::kernels::gravitation_ecef(local_ecef.data(),
+                                   local_gravitation.data(), n);
+  REQUIRE(ecef == local_ecef);
+  REQUIRE(gravitation == local_gravitation);
+}
+
+//! Records written in place are read back from the segment, no copies
+TEST_CASE("service zero-copy", "[service]") {
+  RunningServer running;
+  ServiceClient client(running.server.socket_path(), SEGMENT_BYTES);
+  const std::vector<ImuSample> samples = synthetic_imu_samples(10, 0.01);
+
+  double *segment = client.segment();
+  ennui::service::write_state(landmark_start_state(), segment);
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    ennui::service::write_imu(samples[i],
+                              segment + STATE_RECORD + IMU_RECORD * i);
+  }
+  const std::size_t output = 4096;  // bytes
+  const Response response = client.call(Op::PROPAGATE, samples.size(), 0,
+                                        output);
+  REQUIRE(response.status == static_cast<std::int32_t>(Status::OK));
+  REQUIRE(response.count == samples.size());
+
+  StatePvaSO3 state = landmark_start_state();
+  ennui::kernels::propagate(state, samples.data(), samples.size(), nullptr);
+  const double *states = segment + output / sizeof(double);
+  require_same(ennui::service::read_state(states + STATE_RECORD * 9), state);
+}
+
+//! Malformed requests are rejected with a status, and the session survives
+TEST_CASE("service errors", "[service]") {
+  RunningServer running;
+  ServiceClient client(running.server.socket_path(), 1 << 16);
+  const std::int32_t OUT_OF_RANGE =
+      static_cast<std::int32_t>(Status::OUT_OF_RANGE);
+  const std::int32_t BAD_REQUEST =
+      static_cast<std::int32_t>(Status::BAD_REQUEST);
+
+  REQUIRE(client.call(Op::GRAVITATION_ECEF, 10, 1 << 16, 0).status ==
+          OUT_OF_RANGE);
+  REQUIRE(client.call(Op::GRAVITATION_ECEF, 10, 0, (1 << 16) - 8).status ==
+          OUT_OF_RANGE);
+  REQUIRE(client.call(Op::GRAVITATION_ECEF, 1ull << 60, 0, 0).status ==
+          OUT_OF_RANGE);
+  REQUIRE(client.call(Op::GRAVITATION_ECEF, 10, 4, 1024).status ==
+          OUT_OF_RANGE);  // misaligned
+  REQUIRE(client.call(Op::GRAVITATION_ECEF, 10, 0, 128).status ==
+          BAD_REQUEST);  // overlap
+  REQUIRE(client.call(static_cast<Op>(99), 1, 0, 1024).status ==
+          BAD_REQUEST);
+
+  std::vector<ImuSample> samples = synthetic_imu_samples(1000, 0.01);
+  std::vector<StatePvaSO3> states(samples.size());
+  REQUIRE_THROWS_AS(client.propagate(landmark_start_state(), samples.data(),
+                                     samples.size(), states.data()),
+                    std::runtime_error);
+
+  // Still usable
+  double position[3] = {WhiteHouse_ECEF[0], WhiteHouse_ECEF[1],
+                        WhiteHouse_ECEF[2]};
+  double gravitation[3];
+  client.gravitation_ecef(position, gravitation, 1);
+  REQUIRE(Vector3(gravitation[0], gravitation[1], gravitation[2]) ==
+          ennui::kernels::gravitation_ecef(WhiteHouse_ECEF));
+
+  REQUIRE_THROWS_AS(ServiceClient("/tmp/ennui-no-such-socket", 4096),
+                    std::system_error);
+}
+
+//! Only a stale socket file is replaced: a live daemon or other file is kept
+TEST_CASE("service socket path", "[service]") {
+  {
+    RunningServer running;
+    REQUIRE_THROWS_AS(ServiceServer(running.server.socket_path()),
+                      std::system_error);
+    ServiceClient client(running.server.socket_path(), 4096);
+  }
+
+  // Left behind by a daemon that exited without removing it
+  const std::string path = test_socket_path();
+  const int stale = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  const sockaddr_un address = socket_address(path);
+  REQUIRE(::bind(stale, reinterpret_cast<const sockaddr *>(&address),
+                 sizeof(address)) == 0);
+  ::close(stale);
+  {
+    RunningServer running;
+    ServiceClient client(running.server.socket_path(), 4096);
+  }
+
+  const std::string file = path + ".txt";
+  std::FILE *f = std::fopen(file.c_str(), "w");
+  REQUIRE(f != nullptr);
+  std::fclose(f);
+  REQUIRE_THROWS_AS(ServiceServer(file), std::system_error);
+  REQUIRE(::access(file.c_str(), F_OK) == 0);
+  ::unlink(file.c_str());
+}
+
+/**
+ * A client that shrinks its segment after attaching only fails its own
+ * request (the daemon catches the SIGBUS) and other sessions carry on
+ */
+TEST_CASE("service segment shrunk", "[service]") {
+  RunningServer running;
+  ServiceClient other(running.server.socket_path(), SEGMENT_BYTES);
+
+  const std::string name = "/ennui-test-" + std::to_string(::getpid());
+  const int shm = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  REQUIRE(shm >= 0);
+  REQUIRE(::ftruncate(shm, 1 << 16) == 0);
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  const sockaddr_un address = socket_address(running.server.socket_path());
+  REQUIRE(::connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                    sizeof(address)) == 0);
+  auto call = [fd](Op op, std::uint64_t count, const std::string &segment) {
+    ennui::service::Request request;
+    std::memset(&request, 0, sizeof(request));
+    request.magic = ennui::service::PROTOCOL_MAGIC;
+    request.op = static_cast<std::uint32_t>(op);
+    request.count = count;
+    request.output_offset = 1024;
+    std::strncpy(request.segment, segment.c_str(),
+                 ennui::service::SEGMENT_NAME_SIZE - 1);
+    Response response;
+    response.status = 1;
+    if (ennui::service::detail::write_full(fd, &request, sizeof(request))) {
+      ennui::service::detail::read_full(fd, &response, sizeof(response));
+    }
+    return response.status;
+  };
+  REQUIRE(call(Op::ATTACH, 1 << 16, name) ==
+          static_cast<std::int32_t>(Status::OK));
+  ::shm_unlink(name.c_str());
+  REQUIRE(::ftruncate(shm, 0) == 0);
+  ::close(shm);
+
+  REQUIRE(call(Op::GRAVITATION_ECEF, 10, "") ==
+          static_cast<std::int32_t>(Status::OUT_OF_RANGE));
+  REQUIRE(call(Op::GRAVITATION_ECEF, 10, "") ==
+          static_cast<std::int32_t>(Status::NOT_ATTACHED));
+  ::close(fd);
+
+  double position[3] = {WhiteHouse_ECEF[0], WhiteHouse_ECEF[1],
+                        WhiteHouse_ECEF[2]};
+  double gravitation[3];
+  other.gravitation_ecef(position, gravitation, 1);
+  REQUIRE(Vector3(gravitation[0], gravitation[1], gravitation[2]) ==
+          ennui::kernels::gravitation_ecef(WhiteHouse_ECEF));
+}
+
+//! Concurrent clients are served independently
+TEST_CASE("service concurrent clients", "[service]") {
+  RunningServer running;
+  const std::vector<ImuSample> samples = synthetic_imu_samples(2000, 0.01);
+  StatePvaSO3 expected = landmark_start_state();
+  ennui::kernels::propagate(expected, samples.data(), samples.size(),
+                            nullptr);
+
+  const int clients = 4, rounds = 5;
+  std::vector<int> correct(clients, 0);
+  std::vector<std::thread> threads;
+  for (int c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c]() {
+      ServiceClient client(running.server.socket_path(), SEGMENT_BYTES);
+      std::vector<StatePvaSO3> states(samples.size());
+      for (int r = 0; r < rounds; ++r) {
+        client.propagate(landmark_start_state(), samples.data(), samples.size(),
+                         states.data());
+        correct[c] += states.back().position == expected.position;
+      }
+    });
+  }
+  for (std::thread &t : threads) t.join();
+  for (int c = 0; c < clients; ++c) REQUIRE(correct[c] == rounds);
+  const ennui::service::ServiceStats stats = running.server.stats();
+  REQUIRE(stats.clients == clients);
+  REQUIRE(stats.requests == clients * (rounds + 1));  // plus attach
+  REQUIRE(stats.records == clients * rounds * samples.size());
+}
+
+/**
+ * Service round trips against in-process kernel calls, per batch size.
+ * Hidden by default, run with: Ennui_test "[service][bench]"
+ */
+TEST_CASE("service throughput", "[.][bench][service]") {
+  typedef std::chrono::steady_clock Clock;
+  RunningServer running;
+  ServiceClient client(running.server.socket_path(), 64 << 20);
+  const std::vector<ImuSample> all = synthetic_imu_samples(100000, 0.01);
+
+  for (const std::size_t batch : {1, 16, 256, 4096, 65536}) {
+    const std::size_t calls = (std::max)(std::size_t(20), 200000 / batch);
+    double *segment = client.segment();
+    ennui::service::write_state(landmark_start_state(), segment);
+    for (std::size_t i = 0; i < batch; ++i) {
+      ennui::service::write_imu(all[i],
+                                segment + STATE_RECORD + IMU_RECORD * i);
+    }
+    const std::size_t output =
+        sizeof(double) * (STATE_RECORD + IMU_RECORD * batch);
+    std::vector<StatePvaSO3> states(batch);
+
+    LatencyHistogram remote, local;
+    for (std::size_t k = 0; k < calls; ++k) {
+      const auto t0 = Clock::now();
+      client.call(Op::PROPAGATE, batch, 0, output);
+      const auto t1 = Clock::now();
+      StatePvaSO3 state = landmark_start_state();
+      ennui::kernels::propagate(state, all.data(), batch, states.data());
+      const auto t2 = Clock::now();
+      remote.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        t1 - t0)
+                        .count());
+      local.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       t2 - t1)
+                       .count());
+    }
+    std::cout << "batch " << batch << ": service p50 "
+              << remote.percentile(0.5) << " ns, p99 "
+              << remote.percentile(0.99) << " ns, "
+              << batch * 1e9 / remote.mean() << " samples/s; in-process p50 "
+              << local.percentile(0.5) << " ns, "
+              << batch * 1e9 / local.mean() << " samples/s" << std::endl;
+  }
+}